@@ -0,0 +1,87 @@
+#include "pch.h"
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(_DEBUG)
+namespace
+{
+	//Constant initialized, safe to touch from inside operator new before main
+	//Global instead of per thread, so the allocations of the job system workers are counted too
+	std::atomic<uint64_t> g_NrAllocations{ 0 };
+}
+
+//Replacements of the global operator new & delete, the array and nothrow versions forward to these
+void* operator new(size_t size)
+{
+	g_NrAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = malloc(size == 0 ? 1 : size))
+		return p;
+
+	throw std::bad_alloc{};
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	g_NrAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = _aligned_malloc(size == 0 ? 1 : size, static_cast<size_t>(alignment)))
+		return p;
+
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+	_aligned_free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+	_aligned_free(p);
+}
+#endif
+
+namespace dae
+{
+	uint64_t AllocationCounter::GetCount()
+	{
+#if defined(_DEBUG)
+		return g_NrAllocations.load(std::memory_order_relaxed);
+#else
+		return 0;
+#endif
+	}
+
+	void* AllocationCounter::AllocateUncounted(size_t size, size_t alignment)
+	{
+#if defined(_DEBUG)
+		if (void* p = _aligned_malloc(size == 0 ? 1 : size, alignment))
+			return p;
+
+		throw std::bad_alloc{};
+#else
+		return ::operator new(size, std::align_val_t{ alignment });
+#endif
+	}
+
+	void AllocationCounter::FreeUncounted(void* p, size_t alignment)
+	{
+#if defined(_DEBUG)
+		(void)alignment;
+		_aligned_free(p);
+#else
+		::operator delete(p, std::align_val_t{ alignment });
+#endif
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace dae
+{
+	// Counts the heap allocations made through operator new, by every thread
+	// Only counts in debug builds, used to assert the steady-state frame loop doesn't allocate
+	namespace AllocationCounter
+	{
+		// Number of allocations done by all threads so far, always 0 in release
+		uint64_t GetCount();
+
+		// Heap memory that isn't counted, for the blocks of the FrameArena: arena growth is checked on its own
+		void* AllocateUncounted(size_t size, size_t alignment);
+		void FreeUncounted(void* p, size_t alignment);
+	}
+}
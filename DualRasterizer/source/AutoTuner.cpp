@@ -0,0 +1,83 @@
+#include "pch.h"
+#include "AutoTuner.h"
+#include <fstream>
+#include <thread>
+
+namespace dae
+{
+	namespace
+	{
+		// One line per host: <fingerprint>=<ISA level> <tile size> <workers>
+		const char* g_SettingsPath{ "AutoTune.cfg" };
+
+		bool ParseLevel(const std::string& name, ISALevel& level)
+		{
+			for (ISALevel candidate : { ISALevel::SSE2, ISALevel::AVX2, ISALevel::AVX512 })
+			{
+				if (name != CpuFeatures::GetName(candidate))
+					continue;
+
+				level = candidate;
+				return true;
+			}
+			return false;
+		}
+	}
+
+	std::string AutoTuner::GetHostFingerprint(int width, int height)
+	{
+		std::stringstream fingerprint{};
+		fingerprint << CpuFeatures::GetBrandString() << " | " << std::thread::hardware_concurrency() << " threads | "
+			<< CpuFeatures::GetName(CpuFeatures::GetSupportedLevel()) << " | " << width << "x" << height;
+		return fingerprint.str();
+	}
+
+	bool AutoTuner::Load(const std::string& fingerprint, TuningConfig& config)
+	{
+		std::ifstream file{ g_SettingsPath };
+		std::string line{};
+		while (std::getline(file, line))
+		{
+			//The fingerprint can contain spaces, the config starts after the last '='
+			const size_t separator{ line.rfind('=') };
+			if (separator == std::string::npos || line.compare(0, separator, fingerprint) != 0 || separator != fingerprint.size())
+				continue;
+
+			std::stringstream values{ line.substr(separator + 1) };
+			std::string levelName{};
+			TuningConfig loadedConfig{};
+			if (!(values >> levelName >> loadedConfig.tileSize >> loadedConfig.nrWorkers) || !ParseLevel(levelName, loadedConfig.level))
+				return false;
+
+			config = loadedConfig;
+			return true;
+		}
+		return false;
+	}
+
+	void AutoTuner::Save(const std::string& fingerprint, const TuningConfig& config)
+	{
+		//Keep the lines of the other hosts
+		std::vector<std::string> lines{};
+		{
+			std::ifstream file{ g_SettingsPath };
+			std::string line{};
+			while (std::getline(file, line))
+			{
+				if (line.rfind(fingerprint + "=", 0) != 0 && !line.empty())
+					lines.push_back(line);
+			}
+		}
+
+		std::stringstream line{};
+		line << fingerprint << "=" << CpuFeatures::GetName(config.level) << " " << config.tileSize << " " << config.nrWorkers;
+		lines.push_back(line.str());
+
+		std::ofstream file{ g_SettingsPath, std::ios::trunc };
+		for (const std::string& hostLine : lines)
+			file << hostLine << "\n";
+
+		if (!file)
+			std::cout << "Could not write the auto-tune settings to " << g_SettingsPath << "\n";
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include "CpuFeatures.h"
+
+namespace dae
+{
+	// SOFTWARE RASTERIZER
+	// Settings the auto-tuner sweeps, they interact with the resolution, the caches & the number of cores
+	struct TuningConfig
+	{
+		ISALevel level;
+		int tileSize;
+		int nrWorkers;
+	};
+
+	// Persistence of the best TuningConfig per host, the sweep itself is Renderer::AutoTune
+	namespace AutoTuner
+	{
+		// CPU model, hardware threads, supported ISA level & resolution - hosts with the same fingerprint share a config
+		std::string GetHostFingerprint(int width, int height);
+
+		// Config of this host from the settings file, false when it was never tuned or the file is unreadable
+		bool Load(const std::string& fingerprint, TuningConfig& config);
+		// Adds or replaces the config of this host, the configs of other hosts are kept
+		void Save(const std::string& fingerprint, const TuningConfig& config);
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+#include "Vector3.h"
+#include "Vector4.h"
+#include "Matrix.h"
+
+namespace dae
+{
+	// Object space bounds of a mesh, computed once at load time
+	struct Bounds
+	{
+		Vector3 center{};
+		float radius{};
+		// Axis aligned box, same center as the sphere
+		Vector3 extents{};
+
+		// Box of the positions with the sphere around its center, not the smallest sphere but conservative & one pass
+		// getPosition(i) returns position i of count
+		template<typename GetPosition>
+		static Bounds FromPositions(size_t count, GetPosition getPosition)
+		{
+			if (count == 0)
+				return {};
+
+			Vector3 minimum{ FLT_MAX, FLT_MAX, FLT_MAX };
+			Vector3 maximum{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (size_t i{ 0 }; i < count; ++i)
+			{
+				const Vector3& position{ getPosition(i) };
+				minimum = { std::min(minimum.x, position.x), std::min(minimum.y, position.y), std::min(minimum.z, position.z) };
+				maximum = { std::max(maximum.x, position.x), std::max(maximum.y, position.y), std::max(maximum.z, position.z) };
+			}
+
+			Bounds bounds{};
+			bounds.center = (minimum + maximum) * .5f;
+			bounds.extents = (maximum - minimum) * .5f;
+
+			float sqrRadius{ 0.f };
+			for (size_t i{ 0 }; i < count; ++i)
+				sqrRadius = std::max(sqrRadius, Vector3{ bounds.center, getPosition(i) }.SqrMagnitude());
+			bounds.radius = sqrtf(sqrRadius);
+
+			return bounds;
+		}
+
+		template<typename VertexType>
+		static Bounds FromVertices(const std::vector<VertexType>& vertices)
+		{
+			return FromPositions(vertices.size(), [&vertices](size_t i) -> const Vector3& { return vertices[i].position; });
+		}
+
+		// Largest scale of the axes of an affine matrix, what a radius grows with
+		static float GetMaxScale(const Matrix& worldMatrix)
+		{
+			return sqrtf(std::max(worldMatrix.GetAxisX().SqrMagnitude(), std::max(worldMatrix.GetAxisY().SqrMagnitude(), worldMatrix.GetAxisZ().SqrMagnitude())));
+		}
+	};
+
+	// Plane with a unit normal, points with Dot(normal, p) + distance >= 0 are on the inner side
+	struct Plane
+	{
+		Vector3 normal{};
+		float distance{};
+
+		float GetSignedDistance(const Vector3& point) const
+		{
+			return Vector3::Dot(normal, point) + distance;
+		}
+	};
+
+	// The 6 planes of a view projection, DirectX convention: -w <= x, y <= w & 0 <= z <= w
+	struct Frustum
+	{
+		Plane planes[6]{};
+
+		// Planes in the space the points are in before viewProjection, e.g. world space for view * projection
+		static Frustum FromViewProjection(const Matrix& viewProjection)
+		{
+			//Row vectors: clip = p * M, so every clip coordinate is the dot product with a column
+			const auto column = [&viewProjection](int c) { return Vector4{ viewProjection[0][c], viewProjection[1][c], viewProjection[2][c], viewProjection[3][c] }; };
+			const Vector4 x{ column(0) };
+			const Vector4 y{ column(1) };
+			const Vector4 z{ column(2) };
+			const Vector4 w{ column(3) };
+
+			const Vector4 coefficients[6]{ w + x, w - x, w + y, w - y, z, w - z };
+
+			Frustum frustum{};
+			for (int i{ 0 }; i < 6; ++i)
+			{
+				const Vector3 normal{ coefficients[i] };
+				const float invLength{ 1.f / normal.Magnitude() };
+				frustum.planes[i] = { normal * invLength, coefficients[i].w * invLength };
+			}
+			return frustum;
+		}
+
+		// False when the bounds, transformed by worldMatrix, are completely outside one of the planes
+		// The sphere is the cheap test, the box transformed as an oriented box rejects what the sphere can't
+		bool IsVisible(const Bounds& bounds, const Matrix& worldMatrix) const
+		{
+			const Vector3 axisX{ worldMatrix.GetAxisX() };
+			const Vector3 axisY{ worldMatrix.GetAxisY() };
+			const Vector3 axisZ{ worldMatrix.GetAxisZ() };
+			const Vector3 center{ worldMatrix.TransformPoint(bounds.center) };
+			const float radius{ bounds.radius * Bounds::GetMaxScale(worldMatrix) };
+
+			for (const Plane& plane : planes)
+			{
+				const float signedDistance{ plane.GetSignedDistance(center) };
+				if (signedDistance < -radius)
+					return false;
+
+				//Half the size of the box along the normal
+				const float projectedExtent{ fabsf(Vector3::Dot(plane.normal, axisX)) * bounds.extents.x +
+					fabsf(Vector3::Dot(plane.normal, axisY)) * bounds.extents.y +
+					fabsf(Vector3::Dot(plane.normal, axisZ)) * bounds.extents.z };
+				if (signedDistance < -projectedExtent)
+					return false;
+			}
+			return true;
+		}
+	};
+}
@@ -39,6 +39,12 @@ namespace dae
 		Matrix viewMatrix{};
 		Matrix invViewMatrix{};
 		Matrix projectionMatrix{};
+		Matrix viewProjectionMatrix{};
+		// World space planes of viewProjectionMatrix
+		Frustum frustum{};
+
+		// Incremented whenever a matrix changes, users compare it with the one of their last update
+		uint32_t version{};
 
 		void Initialize(float _fovAngle = 90.f, Vector3 _origin = {0.f,0.f,0.f}, float _aspectRatio = 1)
 		{
@@ -48,6 +54,20 @@ namespace dae
 
 			origin = _origin;
 
+			CalculateViewMatrix();
+			CalculateProjectionMatrix();
+		}
+
+		void SetFovAngle(float _fovAngle)
+		{
+			fovAngle = _fovAngle;
+			fov = tanf((fovAngle * TO_RADIANS) / 2.f);
+			CalculateProjectionMatrix();
+		}
+
+		void SetAspectRatio(float _aspectRatio)
+		{
+			aspectRatio = _aspectRatio;
 			CalculateProjectionMatrix();
 		}
 
@@ -66,16 +86,25 @@ namespace dae
 			return invViewMatrix;
 		}
 
-		Matrix GetWorldViewProjection() const
+		const Matrix& GetWorldViewProjection() const
+		{
+			return viewProjectionMatrix;
+		}
+
+		const Frustum& GetFrustum() const
 		{
-			return GetViewMatrix() * GetProjectionMatrix();
+			return frustum;
 		}
 
 		void CalculateViewMatrix()
 		{
 			//TODO W1
 			viewMatrix = Matrix::CreateLookAtLH(origin, forward, up);
-			invViewMatrix = Matrix::Inverse(viewMatrix);
+			//Rotation & translation only, the cheap inverse is enough
+			invViewMatrix = Matrix::InverseAffine(viewMatrix);
+			viewProjectionMatrix = viewMatrix * projectionMatrix;
+			frustum = Frustum::FromViewProjection(viewProjectionMatrix);
+			++version;
 			//DirectX Implementation => https://learn.microsoft.com/en-us/windows/win32/direct3d9/d3dxmatrixlookatlh
 		}
 
@@ -83,11 +112,18 @@ namespace dae
 		{
 			//TODO W2
 			projectionMatrix = Matrix::CreatePerspectiveFovLH(fov, aspectRatio, nearPlane, farPlane);
+			viewProjectionMatrix = viewMatrix * projectionMatrix;
+			frustum = Frustum::FromViewProjection(viewProjectionMatrix);
+			++version;
 			//DirectX Implementation => https://learn.microsoft.com/en-us/windows/win32/direct3d9/d3dxmatrixperspectivefovlh
 		}
 
 		void Update(const Timer* pTimer)
 		{
+			const Vector3 previousOrigin{ origin };
+			const float previousPitch{ totalPitch };
+			const float previousYaw{ totalYaw };
+
 			const float deltaTime = pTimer->GetElapsed();
 			float speed = 5.f;
 			const float rotationSpeed = 25.f;
@@ -138,16 +174,22 @@ namespace dae
 				totalYaw += mouseX * rotationSpeed * deltaTime;
 			}
 
-			const Matrix finalRotation = Matrix::CreateRotationX(totalPitch * TO_RADIANS) * Matrix::CreateRotationY(totalYaw * TO_RADIANS);
-			forward = finalRotation.TransformVector(Vector3::UnitZ);
-			forward.Normalize();
+			//Matrices only change when the camera moved, the projection only in Initialize, SetFovAngle & SetAspectRatio
+			const bool isMoved{ origin.x != previousOrigin.x || origin.y != previousOrigin.y || origin.z != previousOrigin.z };
+			const bool isRotated{ totalPitch != previousPitch || totalYaw != previousYaw };
+			if (isRotated)
+			{
+				const Matrix finalRotation = Matrix::CreateRotationX(totalPitch * TO_RADIANS) * Matrix::CreateRotationY(totalYaw * TO_RADIANS);
+				forward = finalRotation.TransformVector(Vector3::UnitZ);
+				forward.Normalize();
 
-			up = finalRotation.GetAxisY();
-			right = finalRotation.GetAxisX();
+				up = finalRotation.GetAxisY();
+				right = finalRotation.GetAxisX();
+			}
 
 			//Update Matrices
-			CalculateViewMatrix();
-			CalculateProjectionMatrix(); //Try to optimize this - should only be called once or when fov/aspectRatio changes
+			if (isMoved || isRotated)
+				CalculateViewMatrix();
 		}
 
 	};
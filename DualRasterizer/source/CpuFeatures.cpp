@@ -0,0 +1,160 @@
+#include "pch.h"
+#include "CpuFeatures.h"
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace dae
+{
+	namespace
+	{
+		bool g_HasOverride{ false };
+		ISALevel g_OverrideLevel{ ISALevel::SSE2 };
+
+		struct CpuidRegisters
+		{
+			uint32_t eax, ebx, ecx, edx;
+		};
+
+		CpuidRegisters Cpuid(uint32_t leaf, uint32_t subLeaf)
+		{
+			CpuidRegisters registers{};
+#if defined(_MSC_VER)
+			int values[4]{};
+			__cpuidex(values, int(leaf), int(subLeaf));
+			registers = { uint32_t(values[0]), uint32_t(values[1]), uint32_t(values[2]), uint32_t(values[3]) };
+#elif defined(__x86_64__) || defined(__i386__)
+			__cpuid_count(leaf, subLeaf, registers.eax, registers.ebx, registers.ecx, registers.edx);
+#endif
+			return registers;
+		}
+
+		// Register state the OS saves on a context switch (XCR0)
+		uint64_t GetEnabledXState()
+		{
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#elif defined(__x86_64__) || defined(__i386__)
+			uint32_t eax{}, edx{};
+			__asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+			return uint64_t(edx) << 32 | eax;
+#else
+			return 0;
+#endif
+		}
+
+		bool HasBit(uint32_t value, int bit)
+		{
+			return (value >> bit & 1) != 0;
+		}
+
+		ISALevel DetectLevel()
+		{
+			if (Cpuid(0, 0).eax < 7)
+				return ISALevel::SSE2;
+
+			const CpuidRegisters leaf1{ Cpuid(1, 0) };
+			const CpuidRegisters leaf7{ Cpuid(7, 0) };
+
+			// AVX registers are only usable when the OS saves them
+			if (!HasBit(leaf1.ecx, 27))	// OSXSAVE
+				return ISALevel::SSE2;
+			const uint64_t xState{ GetEnabledXState() };
+
+			constexpr uint64_t avxState{ 0x6 };		// XMM | YMM
+			constexpr uint64_t avx512State{ 0xE6 };	// XMM | YMM | opmask | ZMM
+			const bool hasAVX2{ (xState & avxState) == avxState
+				&& HasBit(leaf1.ecx, 28)	// AVX
+				&& HasBit(leaf1.ecx, 12)	// FMA
+				&& HasBit(leaf7.ebx, 5) };	// AVX2
+			if (!hasAVX2)
+				return ISALevel::SSE2;
+
+			const bool hasAVX512{ (xState & avx512State) == avx512State
+				&& HasBit(leaf7.ebx, 16)	// AVX512F
+				&& HasBit(leaf7.ebx, 17)	// AVX512DQ
+				&& HasBit(leaf7.ebx, 30)	// AVX512BW
+				&& HasBit(leaf7.ebx, 31) };	// AVX512VL
+			return hasAVX512 ? ISALevel::AVX512 : ISALevel::AVX2;
+		}
+	}
+
+	ISALevel CpuFeatures::GetSupportedLevel()
+	{
+		static const ISALevel supportedLevel{ DetectLevel() };
+		return supportedLevel;
+	}
+
+	ISALevel CpuFeatures::GetActiveLevel()
+	{
+		const ISALevel supportedLevel{ GetSupportedLevel() };
+		if (g_HasOverride && g_OverrideLevel < supportedLevel)
+			return g_OverrideLevel;
+
+		return supportedLevel;
+	}
+
+	bool CpuFeatures::SetOverride(const char* levelName)
+	{
+		for (ISALevel level : { ISALevel::SSE2, ISALevel::AVX2, ISALevel::AVX512 })
+		{
+			if (_stricmp(levelName, GetName(level)) != 0)
+				continue;
+
+			if (level > GetSupportedLevel())
+				std::cout << "ISA override " << GetName(level) << " is not supported by this CPU, using " << GetName(GetSupportedLevel()) << "\n";
+
+			g_HasOverride = true;
+			g_OverrideLevel = level;
+			return true;
+		}
+		return false;
+	}
+
+	bool CpuFeatures::HasOverride()
+	{
+		return g_HasOverride;
+	}
+
+	const char* CpuFeatures::GetName(ISALevel level)
+	{
+		switch (level)
+		{
+		case ISALevel::SSE2:
+			return "SSE2";
+		case ISALevel::AVX2:
+			return "AVX2";
+		case ISALevel::AVX512:
+			return "AVX512";
+		}
+		return "UNKNOWN";
+	}
+
+	const char* CpuFeatures::GetBrandString()
+	{
+		static const std::string brandString{ []()
+			{
+				if (Cpuid(0x80000000, 0).eax < 0x80000004)
+					return std::string{};
+
+				//48 characters in the registers of leaves 0x80000002 - 0x80000004
+				char brand[49]{};
+				for (uint32_t i{ 0 }; i < 3; ++i)
+				{
+					const CpuidRegisters registers{ Cpuid(0x80000002 + i, 0) };
+					memcpy(brand + i * 16, &registers, 16);
+				}
+
+				//Some CPUs pad the name with leading spaces
+				std::string name{ brand };
+				const size_t first{ name.find_first_not_of(' ') };
+				return first == std::string::npos ? std::string{} : name.substr(first);
+			}() };
+		return brandString.c_str();
+	}
+}
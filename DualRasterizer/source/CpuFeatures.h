@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+
+namespace dae
+{
+	// Instruction set levels the software kernels are compiled for, ordered from old to new
+	enum class ISALevel : uint32_t
+	{
+		SSE2,		// x64 baseline, also what SSE4-only hosts run
+		AVX2,		// AVX2 + FMA
+		AVX512		// AVX-512 F/BW/DQ/VL
+	};
+
+	namespace CpuFeatures
+	{
+		// Highest level the CPU and the OS (saved register state) support, detected once through CPUID
+		ISALevel GetSupportedLevel();
+
+		// Level the kernels run at: the supported level unless it was overridden with a lower one
+		ISALevel GetActiveLevel();
+
+		// Forces a level, e.g. for benchmarks - clamped to the supported level
+		// Has to be called before the first kernel is used, returns false for an unknown name
+		bool SetOverride(const char* levelName);
+		bool HasOverride();
+
+		const char* GetName(ISALevel level);
+
+		// CPU model name from CPUID, empty when the CPU doesn't report one
+		const char* GetBrandString();
+	}
+}
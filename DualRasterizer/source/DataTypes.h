@@ -1,4 +1,6 @@
 #pragma once
+#include <span>
+#include <vector>
 #include "Math.h"
 
 using namespace dae;
@@ -12,16 +14,39 @@ struct Vertex
 };
 
 // From software rasterizer
+// Interpolated vertex output that is handed to the pixel shader
 struct Vertex_Out
 {
 	Vector4 position{};
-	ColorRGB color{ colors::White };
 	Vector2 uv{};
 	Vector3 normal{};
 	Vector3 tangent{};
 	Vector3 viewDirection{};
 };
 
+// From software rasterizer
+// Vertex_Out attributes a shading mode reads, position is always live
+// Attributes that are not live are neither written by the vertex stage nor interpolated
+enum class Varying : uint32_t
+{
+	None = 0,
+	UV = 1 << 0,
+	Normal = 1 << 1,
+	Tangent = 1 << 2,
+	ViewDirection = 1 << 3,
+	All = UV | Normal | Tangent | ViewDirection
+};
+
+inline Varying operator|(Varying a, Varying b)
+{
+	return Varying(uint32_t(a) | uint32_t(b));
+}
+
+inline bool HasVarying(Varying mask, Varying varying)
+{
+	return (uint32_t(mask) & uint32_t(varying)) != 0;
+}
+
 // From software rasterizer
 enum class PrimitiveTopology
 {
@@ -29,13 +54,78 @@ enum class PrimitiveTopology
 	TriangleStrip
 };
 
+// From software rasterizer
+// Cluster of at most 64 vertices & 124 triangles of a Mesh, see BuildMeshlets
+// Culled as a whole, before any of its vertices is transformed
+struct Meshlet
+{
+	// Vertices [vertexOffset, vertexOffset + nrVertices) of Mesh::meshletVertices
+	uint32_t vertexOffset{};
+	uint32_t nrVertices{};
+	// Triangles [triangleOffset, triangleOffset + nrTriangles), 3 indices each in Mesh::meshletTriangles, relative to vertexOffset
+	uint32_t triangleOffset{};
+	uint32_t nrTriangles{};
+
+	// Object space
+	Bounds bounds{};
+	// Every face normal is within the cone around coneAxis with half angle acos(coneCos)
+	// A cone of 90 degrees or more is never back-facing: coneCos 0 & coneSin 1
+	Vector3 coneAxis{};
+	float coneCos{};
+	float coneSin{ 1.f };
+
+	// True when no triangle can face the camera: every point of the bounds sees every normal of the cone pointing away
+	// worldMatrix: rotation, translation & uniform scale
+	bool IsBackFacing(const Matrix& worldMatrix, const Vector3& cameraOrigin) const
+	{
+		const Vector3 toCenter{ cameraOrigin, worldMatrix.TransformPoint(bounds.center) };
+		const Vector3 axis{ worldMatrix.TransformVector(coneAxis).Normalized() };
+		const float radius{ bounds.radius * Bounds::GetMaxScale(worldMatrix) };
+
+		//Smallest Dot(normal, toCenter) of the normals in the cone, |toCenter| * cos(angle to the axis + half angle)
+		const float alongAxis{ Vector3::Dot(toCenter, axis) };
+		const float acrossAxis{ sqrtf(std::max(toCenter.SqrMagnitude() - alongAxis * alongAxis, 0.f)) };
+		return alongAxis * coneCos - acrossAxis * coneSin > radius;
+	}
+};
+
 // From software rasterizer
 struct Mesh
 {
 	std::vector<Vertex> vertices{};
 	std::vector<uint32_t> indices{};
 	PrimitiveTopology primitiveTopology{ PrimitiveTopology::TriangleStrip };
+	// Object space, computed from the vertices when they are loaded
+	Bounds bounds{};
+	// Optional split of the triangles, empty until BuildMeshlets
+	// The vertices of every meshlet are a copy, one meshlet after the other, so a meshlet transforms one contiguous range
+	std::vector<Meshlet> meshlets{};
+	std::vector<Vertex> meshletVertices{};
+	std::vector<uint8_t> meshletTriangles{};
 
-	std::vector<Vertex_Out> vertices_out{};
 	Matrix worldMatrix{};
-};
\ No newline at end of file
+};
+
+// From software rasterizer
+// Per frame snapshot & post-transform vertices of one Mesh, owned by the frame that is in flight
+struct MeshFrame
+{
+	Matrix worldMatrix{};
+	// False when the bounds are outside the frustum, nothing below is allocated then
+	bool isVisible{};
+	// Drawn as meshlets: the streams below are indexed like Mesh::meshletVertices, only the ranges of visibleMeshlets are written
+	bool isUsingMeshlets{};
+	// Indices in Mesh::meshlets of the meshlets that passed culling, in order
+	std::span<const uint32_t> visibleMeshlets{};
+
+	// Post-transform vertices, one cache line aligned stream per attribute
+	// Allocated from the arena of the frame, only valid until that frame is rasterized
+	// Hot: read by every triangle for culling, bounding box, edge functions and depth
+	// x & y in raster space, z in NDC, w = 1 / view space depth
+	std::span<Vector4> positions_out{};
+	// Cold: only read for covered pixels, empty when the attribute isn't live
+	std::span<Vector2> uvs_out{};
+	std::span<Vector3> normals_out{};
+	std::span<Vector3> tangents_out{};
+	std::span<Vector3> viewDirections_out{};
+};
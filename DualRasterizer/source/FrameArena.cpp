@@ -0,0 +1,82 @@
+#include "pch.h"
+#include "FrameArena.h"
+#include "AllocationCounter.h"
+#include <cassert>
+#include <new>
+
+namespace dae
+{
+	FrameArena::FrameArena(size_t capacity)
+	{
+		//A few spare entries, so growing never reallocates the block list
+		m_Blocks.reserve(8);
+		AddBlock(capacity);
+	}
+
+	FrameArena::~FrameArena()
+	{
+		for (const Block& block : m_Blocks)
+			AllocationCounter::FreeUncounted(block.pData, CacheLineSize);
+	}
+
+	void* FrameArena::Allocate(size_t size, size_t alignment)
+	{
+		assert((alignment & (alignment - 1)) == 0 && "ERROR: alignment has to be a power of 2!");
+
+		const Block& block{ m_Blocks.back() };
+		size_t alignedOffset{ (m_Offset + alignment - 1) & ~(alignment - 1) };
+
+		if (alignedOffset + size > block.size)
+		{
+			//Current block is full - continue in a new block that is at least twice as big
+			m_UsedInFullBlocks += m_Offset;
+			AddBlock(std::max(block.size * 2, size + alignment));
+			++m_NrGrowths;
+			alignedOffset = 0;
+		}
+
+		m_Offset = alignedOffset + size;
+		return m_Blocks.back().pData + alignedOffset;
+	}
+
+	void FrameArena::Reset()
+	{
+		if (m_Blocks.size() > 1)
+		{
+			//This frame needed more than one block, replace them by a single block that fits the whole frame
+			const size_t capacity{ GetCapacity() };
+			for (const Block& block : m_Blocks)
+				AllocationCounter::FreeUncounted(block.pData, CacheLineSize);
+			m_Blocks.clear();
+
+			AddBlock(capacity);
+		}
+
+		m_Offset = 0;
+		m_UsedInFullBlocks = 0;
+	}
+
+	size_t FrameArena::GetCapacity() const
+	{
+		size_t capacity{};
+		for (const Block& block : m_Blocks)
+			capacity += block.size;
+
+		return capacity;
+	}
+
+	FrameArena& FrameArena::GetThreadArena()
+	{
+		thread_local FrameArena threadArena{ m_DefaultThreadCapacity };
+		return threadArena;
+	}
+
+	void FrameArena::AddBlock(size_t size)
+	{
+		//Blocks start on a cache line, so aligned offsets are aligned addresses
+		//Not counted as a heap allocation of the frame loop, growing is tracked by m_NrGrowths
+		uint8_t* pData{ static_cast<uint8_t*>(AllocationCounter::AllocateUncounted(size, CacheLineSize)) };
+		assert(m_Blocks.size() < m_Blocks.capacity() && "ERROR: the block list of the FrameArena would reallocate!");
+		m_Blocks.push_back(Block{ pData, size });
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dae
+{
+	constexpr size_t CacheLineSize{ 64 };
+
+	// Linear allocator for the temporaries of one software rasterizer frame
+	// Allocating only bumps an offset, everything is released at once by Reset at the end of the frame
+	// When a frame needs more than the capacity an extra block is added,
+	// Reset merges the blocks so the following frames don't allocate anymore
+	class FrameArena final
+	{
+	public:
+		FrameArena(size_t capacity);
+		~FrameArena();
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena(FrameArena&&) noexcept = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+		FrameArena& operator=(FrameArena&&) noexcept = delete;
+
+		void* Allocate(size_t size, size_t alignment = CacheLineSize);
+
+		// Uninitialized storage for count objects, cache line aligned
+		template<typename T>
+		T* Allocate(size_t count)
+		{
+			return static_cast<T*>(Allocate(count * sizeof(T), alignof(T) > CacheLineSize ? alignof(T) : CacheLineSize));
+		}
+
+		void Reset();
+
+		size_t GetCapacity() const;
+		size_t GetUsed() const { return m_UsedInFullBlocks + m_Offset; }
+		// Total number of times the arena had to allocate a new block
+		size_t GetNrGrowths() const { return m_NrGrowths; }
+
+		// Arena of the calling thread, every thread resets its own arena at the end of its frame
+		static FrameArena& GetThreadArena();
+	private:
+		struct Block
+		{
+			uint8_t* pData;
+			size_t size;
+		};
+
+		static constexpr size_t m_DefaultThreadCapacity{ 16 * 1024 * 1024 };
+
+		// The last block is the one that is being allocated from
+		std::vector<Block> m_Blocks{};
+		size_t m_Offset{};
+		size_t m_UsedInFullBlocks{};
+		size_t m_NrGrowths{};
+
+		void AddBlock(size_t size);
+	};
+}
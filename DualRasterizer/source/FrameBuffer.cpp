@@ -0,0 +1,264 @@
+#include "pch.h"
+#include "FrameBuffer.h"
+#include "FrameArena.h"
+#include "SIMD.h"
+#include "JobSystem.h"
+#include "SoftwareKernels.h"
+#include <cassert>
+
+#if defined(DAE_SIMD_SSE)
+#include <emmintrin.h>
+#endif
+
+namespace dae
+{
+	namespace
+	{
+		// Fill that bypasses the cache, for pixels nobody reads again before present
+		void StreamFill(uint32_t* pDestination, size_t count, uint32_t value)
+		{
+#if defined(DAE_SIMD_SSE)
+			//Scalar until the destination is 16-byte aligned
+			while (count > 0 && reinterpret_cast<uintptr_t>(pDestination) % 16 != 0)
+			{
+				*pDestination++ = value;
+				--count;
+			}
+
+			const __m128i values{ _mm_set1_epi32(int(value)) };
+			for (; count >= 4; count -= 4, pDestination += 4)
+			{
+				_mm_stream_si128(reinterpret_cast<__m128i*>(pDestination), values);
+			}
+#endif
+			std::fill_n(pDestination, count, value);
+		}
+
+		// Copy that bypasses the cache, for pixels nobody reads again before present
+		void StreamCopy(uint32_t* pDestination, const uint32_t* pSource, size_t count)
+		{
+#if defined(DAE_SIMD_SSE)
+			while (count > 0 && reinterpret_cast<uintptr_t>(pDestination) % 16 != 0)
+			{
+				*pDestination++ = *pSource++;
+				--count;
+			}
+
+			for (; count >= 4; count -= 4, pDestination += 4, pSource += 4)
+			{
+				_mm_stream_si128(reinterpret_cast<__m128i*>(pDestination), _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource)));
+			}
+#endif
+			std::copy_n(pSource, count, pDestination);
+		}
+	}
+
+	FrameBuffer::FrameBuffer(int width, int height, int tileSize)
+		: m_Width{ width }
+		, m_Height{ height }
+		, m_NrBlocksX{ (width + BlockSize - 1) / BlockSize }
+		, m_NrBlocksY{ (height + BlockSize - 1) / BlockSize }
+	{
+		SetTileSize(tileSize);
+		m_DepthBlocks.resize(size_t(m_NrBlocksX) * m_NrBlocksY);
+
+		const size_t nrPixels{ size_t(m_NrBlocksX) * m_NrBlocksY * BlockSize * BlockSize };
+		m_pColor = static_cast<uint32_t*>(::operator new(sizeof(uint32_t) * nrPixels, std::align_val_t{ CacheLineSize }));
+		m_pDepth = static_cast<float*>(::operator new(sizeof(float) * nrPixels, std::align_val_t{ CacheLineSize }));
+	}
+
+	FrameBuffer::~FrameBuffer()
+	{
+		::operator delete(m_pColor, std::align_val_t{ CacheLineSize });
+		::operator delete(m_pDepth, std::align_val_t{ CacheLineSize });
+	}
+
+	void FrameBuffer::SetTileSize(int tileSize)
+	{
+		assert(tileSize > 0 && tileSize <= MaxTileSize && tileSize % BlockSize == 0 && "ERROR: tile size out of range or not a whole number of blocks!");
+
+		m_TileSize = tileSize;
+		m_NrTilesX = (m_Width + tileSize - 1) / tileSize;
+		m_NrTilesY = (m_Height + tileSize - 1) / tileSize;
+		m_IsTileTouched.assign(size_t(m_NrTilesX) * m_NrTilesY, uint8_t{ 0 });
+	}
+
+	void FrameBuffer::BeginFrame(uint32_t* pTarget, uint32_t clearColor, bool isDepthCompressed)
+	{
+		m_pTarget = pTarget;
+		m_ClearColor = clearColor;
+		m_IsDepthCompressed = isDepthCompressed;
+
+		std::fill(m_IsTileTouched.begin(), m_IsTileTouched.end(), uint8_t{ 0 });
+	}
+
+	void FrameBuffer::TouchRect(int pxBegin, int pyBegin, int pxEnd, int pyEnd)
+	{
+		if (pxBegin >= pxEnd || pyBegin >= pyEnd)
+			return;
+
+		const int tileXEnd{ (pxEnd - 1) / m_TileSize + 1 };
+		const int tileYEnd{ (pyEnd - 1) / m_TileSize + 1 };
+		for (int tileY{ pyBegin / m_TileSize }; tileY < tileYEnd; ++tileY)
+		{
+			for (int tileX{ pxBegin / m_TileSize }; tileX < tileXEnd; ++tileX)
+			{
+				uint8_t& isTouched{ m_IsTileTouched[tileX + tileY * m_NrTilesX] };
+				if (isTouched)
+					continue;
+
+				isTouched = 1;
+				ClearTile(tileX, tileY);
+			}
+		}
+	}
+
+	void FrameBuffer::DecompressDepthBlock(int px, int py, const SoftwareKernels& kernels)
+	{
+		DepthBlock& depthBlock{ GetDepthBlock(px, py) };
+		if (depthBlock.state == DepthBlockState::Raw)
+			return;
+
+		const int blockPx{ px - px % BlockSize };
+		const int blockPy{ py - py % BlockSize };
+		float* pDepth{ m_pDepth + GetOffset(blockPx, blockPy) };
+		std::fill_n(pDepth, BlockSize * BlockSize, FLT_MAX);
+
+		//The plane covered every pixel, against a cleared block each of them passes with the depth it had
+		if (depthBlock.state == DepthBlockState::Plane)
+		{
+			Fragment pFragments[BlockSize];
+			for (int row{ 0 }; row < BlockSize; ++row)
+				kernels.RasterizeRow(*depthBlock.pPlane, blockPy + row, blockPx, blockPx + BlockSize, pDepth + row * BlockSize, pFragments);
+		}
+		depthBlock.state = DepthBlockState::Raw;
+	}
+
+	void FrameBuffer::UpdateDepthBounds(int px, int py)
+	{
+		DepthBlock& depthBlock{ GetDepthBlock(px, py) };
+		assert(depthBlock.state == DepthBlockState::Raw && "ERROR: only the bounds of a Raw depth block are updated from its pixels!");
+
+		const float* pDepth{ m_pDepth + GetOffset(px - px % BlockSize, py - py % BlockSize) };
+		const auto [pMin, pMax] { std::minmax_element(pDepth, pDepth + BlockSize * BlockSize) };
+		depthBlock.minDepth = *pMin;
+		depthBlock.maxDepth = *pMax;
+	}
+
+	void FrameBuffer::Resolve()
+	{
+		//Rows of tiles are resolved in parallel, the target is written row after row
+		JobSystem::Get().ParallelFor(size_t(m_NrTilesY), 1, [this](size_t tileYBegin, size_t tileYEnd)
+			{
+				const int pyBegin{ int(tileYBegin) * m_TileSize };
+				const int pyEnd{ std::min(int(tileYEnd) * m_TileSize, m_Height) };
+				for (int py{ pyBegin }; py < pyEnd; ++py)
+				{
+					const int tileY{ py / m_TileSize };
+					uint32_t* pTargetRow{ m_pTarget + size_t(py) * m_Width };
+
+					int tileX{ 0 };
+					while (tileX < m_NrTilesX)
+					{
+						const int runBegin{ tileX };
+						const bool isTouched{ m_IsTileTouched[tileX + tileY * m_NrTilesX] != 0 };
+						while (tileX < m_NrTilesX && (m_IsTileTouched[tileX + tileY * m_NrTilesX] != 0) == isTouched)
+							++tileX;
+
+						const int pxBegin{ runBegin * m_TileSize };
+						const int pxEnd{ std::min(tileX * m_TileSize, m_Width) };
+						if (!isTouched)
+						{
+							//Untouched tiles next to each other in a row are filled as one run
+							StreamFill(pTargetRow + pxBegin, size_t(pxEnd - pxBegin), m_ClearColor);
+							continue;
+						}
+
+						//One row of a block at a time, contiguous in the blocked storage
+						for (int px{ pxBegin }; px < pxEnd; px += BlockSize)
+						{
+							StreamCopy(pTargetRow + px, m_pColor + GetOffset(px, py), size_t(std::min(BlockSize, pxEnd - px)));
+						}
+					}
+				}
+
+#if defined(DAE_SIMD_SSE)
+				//Streaming stores are weakly ordered, every thread makes its own visible before the buffer is presented
+				_mm_sfence();
+#endif
+			});
+	}
+
+	uint64_t FrameBuffer::GetHash() const
+	{
+		uint64_t hash{ 14695981039346656037ull };
+		const auto hashBytes = [&hash](const void* pData, size_t size)
+			{
+				const uint8_t* pBytes{ static_cast<const uint8_t*>(pData) };
+				for (size_t i{ 0 }; i < size; ++i)
+				{
+					hash ^= pBytes[i];
+					hash *= 1099511628211ull;
+				}
+			};
+
+		for (int py{ 0 }; py < m_Height; ++py)
+		{
+			for (int px{ 0 }; px < m_Width; ++px)
+			{
+				//Untouched tiles were never cleared, they hold the previous frame
+				const bool isTouched{ m_IsTileTouched[px / m_TileSize + (py / m_TileSize) * m_NrTilesX] != 0 };
+				const uint32_t color{ isTouched ? m_pColor[GetOffset(px, py)] : m_ClearColor };
+				hashBytes(&color, sizeof(color));
+
+				float depth{ isTouched ? m_pDepth[GetOffset(px, py)] : FLT_MAX };
+				if (m_IsDepthCompressed && isTouched)
+				{
+					//Only Raw blocks have per pixel depth, the plane of a Plane block is a temporary of the frame so its bounds stand in for it
+					const DepthBlock& depthBlock{ m_DepthBlocks[size_t(py / BlockSize) * m_NrBlocksX + size_t(px / BlockSize)] };
+					if (depthBlock.state == DepthBlockState::Cleared)
+						depth = FLT_MAX;
+					else if (depthBlock.state == DepthBlockState::Plane)
+					{
+						if (px % BlockSize == 0 && py % BlockSize == 0)
+						{
+							hashBytes(&depthBlock.state, sizeof(depthBlock.state));
+							hashBytes(&depthBlock.minDepth, sizeof(depthBlock.minDepth));
+							hashBytes(&depthBlock.maxDepth, sizeof(depthBlock.maxDepth));
+						}
+						continue;
+					}
+				}
+				hashBytes(&depth, sizeof(depth));
+			}
+		}
+		return hash;
+	}
+
+	void FrameBuffer::ClearTile(int tileX, int tileY)
+	{
+		//Regular stores, the triangle that touched the tile writes to it right after this
+		//A tile row of blocks is contiguous, padding blocks past the edges are cleared too
+		const int blocksPerTile{ m_TileSize / BlockSize };
+		const int blockXBegin{ tileX * blocksPerTile };
+		const int blockXEnd{ std::min(blockXBegin + blocksPerTile, m_NrBlocksX) };
+		const int blockYBegin{ tileY * blocksPerTile };
+		const int blockYEnd{ std::min(blockYBegin + blocksPerTile, m_NrBlocksY) };
+
+		const size_t nrPixels{ size_t(blockXEnd - blockXBegin) * BlockSize * BlockSize };
+		for (int blockY{ blockYBegin }; blockY < blockYEnd; ++blockY)
+		{
+			const size_t offset{ GetOffset(blockXBegin * BlockSize, blockY * BlockSize) };
+			std::fill_n(m_pColor + offset, nrPixels, m_ClearColor);
+
+			//Compressed depth only resets the metadata, a block writes its pixels when it is decompressed
+			if (m_IsDepthCompressed)
+			{
+				DepthBlock* pDepthBlocks{ &m_DepthBlocks[size_t(blockY) * m_NrBlocksX] };
+				std::fill(pDepthBlocks + blockXBegin, pDepthBlocks + blockXEnd, DepthBlock{ FLT_MAX, FLT_MAX, nullptr, DepthBlockState::Cleared });
+			}
+			else
+				std::fill_n(m_pDepth + offset, nrPixels, FLT_MAX);
+		}
+	}
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ColorRGB.h"
+
+namespace dae
+{
+	struct TriangleSetup;
+	struct SoftwareKernels;
+
+	// SOFTWARE RASTERIZER
+	// Color & depth target with lazy, tile granular clears
+	// BeginFrame only resets one flag per tile, a tile is cleared the first time a triangle touches it
+	// Resolve fills the color of the tiles nothing touched, depth of those tiles is never read so it stays stale
+	// Pixels have one fixed layout: 0xAARRGGBB, SDL_PIXELFORMAT_ARGB8888
+	// Color & depth are stored in BlockSize x BlockSize blocks, the pixels of a block are contiguous & row after row,
+	// the blocks are row after row too - Resolve linearizes the color into the presented buffer
+	// Optionally the depth of a block is compressed: min/max per block plus the plane of the one triangle that covers it,
+	// the per pixel depth is only written when a triangle covers a block partially
+	class FrameBuffer final
+	{
+	public:
+		FrameBuffer(int width, int height, int tileSize = 32);
+		~FrameBuffer();
+
+		FrameBuffer(const FrameBuffer&) = delete;
+		FrameBuffer(FrameBuffer&&) noexcept = delete;
+		FrameBuffer& operator=(const FrameBuffer&) = delete;
+		FrameBuffer& operator=(FrameBuffer&&) noexcept = delete;
+
+		// Upper bound of the tile size, e.g. for per tile row arrays on the stack
+		static constexpr int MaxTileSize{ 128 };
+		// Tiles are a whole number of blocks
+		static constexpr int BlockSize{ 8 };
+
+		// Same result as ColorRGB::MaxToOne followed by a truncating cast to [0, 255] per channel,
+		// done in registers instead of going through SDL_MapRGB
+		static uint32_t PackColor(const ColorRGB& color)
+		{
+			const float maxValue{ std::max(color.r, std::max(color.g, color.b)) };
+			const float divisor{ maxValue > 1.f ? maxValue : 1.f };
+
+			const uint32_t r{ uint32_t(std::max(color.r / divisor, 0.f) * 255) };
+			const uint32_t g{ uint32_t(std::max(color.g / divisor, 0.f) * 255) };
+			const uint32_t b{ uint32_t(std::max(color.b / divisor, 0.f) * 255) };
+			return 0xFF000000 | r << 16 | g << 8 | b;
+		}
+
+		enum class DepthBlockState : uint8_t
+		{
+			Cleared,	//Every pixel at FLT_MAX, nothing in the per pixel depth
+			Plane,		//Every pixel covered by pPlane, nothing in the per pixel depth
+			Raw			//Per pixel depth is valid
+		};
+		// Depth metadata of a block, the bounds are conservative: no pixel of the block is outside [minDepth, maxDepth]
+		struct DepthBlock
+		{
+			float minDepth;
+			float maxDepth;
+			// Triangle of this frame whose RasterizeRow depth is the depth of every pixel
+			const TriangleSetup* pPlane;
+			DepthBlockState state;
+		};
+
+		// pTarget: width * height pixels, row after row, not owned - only written by Resolve
+		// isDepthCompressed: the depth of a cleared tile is only the metadata of its blocks, see GetDepthBlock
+		void BeginFrame(uint32_t* pTarget, uint32_t clearColor, bool isDepthCompressed = false);
+		// Clears the tiles of the pixel rectangle [pxBegin, pxEnd) x [pyBegin, pyEnd) that weren't touched yet this frame
+		// Has to be called before the color or depth of those pixels is read or written
+		// Threads can touch different tiles at the same time, not the same tile
+		void TouchRect(int pxBegin, int pyBegin, int pxEnd, int pyEnd);
+		// Linearizes the touched tiles & fills the untouched ones in the target with non-temporal stores, call before presenting
+		void Resolve();
+		// FNV-1a of the color Resolve presents & of the depth, row after row - a content hash of the frame
+		// Compressed depth: a Plane block is hashed by its bounds, Cleared & Raw ones by their pixels
+		uint64_t GetHash() const;
+
+		// Tiles are square, in pixels - also the granularity the software rasterizer bins & schedules at
+		int GetTileSize() const { return m_TileSize; }
+		int GetNrTilesX() const { return m_NrTilesX; }
+		int GetNrTilesY() const { return m_NrTilesY; }
+		// Only between frames, a multiple of BlockSize
+		void SetTileSize(int tileSize);
+
+		// Blocked storage, index with GetOffset
+		uint32_t* GetColor() const { return m_pColor; }
+		float* GetDepth() const { return m_pDepth; }
+		bool IsDepthCompressed() const { return m_IsDepthCompressed; }
+		// Block of pixel (px, py), only valid when the depth is compressed
+		DepthBlock& GetDepthBlock(int px, int py) { return m_DepthBlocks[size_t(py / BlockSize) * m_NrBlocksX + size_t(px / BlockSize)]; }
+		// Writes the per pixel depth of a Cleared or Plane block, a Raw block is left as it is - the block is Raw after this
+		// kernels: the ones the planes of this frame are rasterized with, decompression has to give the same depth bit for bit
+		void DecompressDepthBlock(int px, int py, const SoftwareKernels& kernels);
+		// Min/max of the per pixel depth of a Raw block, after it was written
+		void UpdateDepthBounds(int px, int py);
+
+		// Index of pixel (px, py) in the color & depth storage, the pixels [px, px + BlockSize - px % BlockSize) of the row follow it
+		size_t GetOffset(int px, int py) const
+		{
+			const size_t block{ size_t(py / BlockSize) * m_NrBlocksX + size_t(px / BlockSize) };
+			return block * (BlockSize * BlockSize) + size_t(py % BlockSize) * BlockSize + size_t(px % BlockSize);
+		}
+	private:
+		int m_Width{};
+		int m_Height{};
+		int m_TileSize{};
+		int m_NrTilesX{};
+		int m_NrTilesY{};
+		int m_NrBlocksX{};
+		int m_NrBlocksY{};
+
+		// Whole blocks, the pixels past the width & height are padding
+		uint32_t* m_pColor{ nullptr };
+		float* m_pDepth{ nullptr };
+		uint32_t* m_pTarget{ nullptr };
+		uint32_t m_ClearColor{};
+
+		bool m_IsDepthCompressed{ false };
+		std::vector<DepthBlock> m_DepthBlocks{};
+
+		// 1 when the tile has been cleared this frame
+		std::vector<uint8_t> m_IsTileTouched{};
+
+		void ClearTile(int tileX, int tileY);
+	};
+}
@@ -0,0 +1,285 @@
+#include "pch.h"
+#include "JobSystem.h"
+#include <cassert>
+#include <new>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace dae
+{
+	namespace
+	{
+		int g_ConfiguredNrWorkers{ 0 };
+		bool g_IsPinningThreads{ false };
+
+		// Queue of the calling thread in the job system that assigned it
+		thread_local const JobSystem* t_pQueueOwner{ nullptr };
+		thread_local int t_QueueIndex{ -1 };
+
+		// False when the platform can't pin or refused
+		bool PinThread(std::thread& thread, int hardwareThread)
+		{
+#if defined(_WIN32)
+			//An affinity mask only covers the 64 logical processors of one group, find the group of the hardware thread
+			const WORD nrGroups{ GetActiveProcessorGroupCount() };
+			for (WORD group{ 0 }; group < nrGroups; ++group)
+			{
+				const int nrGroupThreads{ int(GetActiveProcessorCount(group)) };
+				if (hardwareThread >= nrGroupThreads)
+				{
+					hardwareThread -= nrGroupThreads;
+					continue;
+				}
+
+				GROUP_AFFINITY affinity{};
+				affinity.Group = group;
+				affinity.Mask = KAFFINITY{ 1 } << hardwareThread;
+				return SetThreadGroupAffinity(thread.native_handle(), &affinity, nullptr) != 0;
+			}
+			return false;
+#elif defined(__linux__)
+			cpu_set_t cpuSet;
+			CPU_ZERO(&cpuSet);
+			CPU_SET(hardwareThread, &cpuSet);
+			return pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuSet) == 0;
+#else
+			(void)thread;
+			(void)hardwareThread;
+			return false;
+#endif
+		}
+	}
+
+	JobSystem::JobSystem(int nrWorkers, bool isPinningThreads)
+		: m_Queues(size_t(nrWorkers + m_MaxExternalThreads))
+	{
+		assert(nrWorkers > 0 && "ERROR: the job system needs at least one worker!");
+		m_NrActiveWorkers = nrWorkers;
+
+		for (JobQueue& queue : m_Queues)
+		{
+			queue.ppJobs = new Job* [m_MaxJobsPerThread] {};
+			queue.pJobs = static_cast<Job*>(::operator new(sizeof(Job) * m_MaxJobsPerThread, std::align_val_t{ CacheLineSize }));
+			//Every slot starts out finished, so free
+			for (uint32_t i{ 0 }; i < m_MaxJobsPerThread; ++i)
+				new(&queue.pJobs[i].nrUnfinishedJobs) std::atomic<int32_t>{ 0 };
+		}
+
+		const int nrHardwareThreads{ int(std::thread::hardware_concurrency()) };
+		if (isPinningThreads && nrHardwareThreads <= 1)
+			std::cout << "Thread pinning skipped, there is only one hardware thread\n";
+
+		int nrUnpinnedWorkers{ 0 };
+		m_Workers.reserve(nrWorkers);
+		for (int i{ 0 }; i < nrWorkers; ++i)
+		{
+			m_Workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+
+			//Hardware thread 0 is left to the main thread
+			if (isPinningThreads && nrHardwareThreads > 1 && !PinThread(m_Workers.back(), 1 + i % (nrHardwareThreads - 1)))
+				++nrUnpinnedWorkers;
+		}
+		if (nrUnpinnedWorkers > 0)
+			std::cout << "Thread pinning isn't supported or failed for " << nrUnpinnedWorkers << " of " << nrWorkers << " workers, they aren't pinned\n";
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard lock{ m_SleepMutex };
+			m_IsStopping = true;
+		}
+		m_WakeUp.notify_all();
+		for (std::thread& worker : m_Workers)
+			worker.join();
+
+		for (JobQueue& queue : m_Queues)
+		{
+			delete[] queue.ppJobs;
+			::operator delete(queue.pJobs, std::align_val_t{ CacheLineSize });
+		}
+	}
+
+	void JobSystem::Configure(int nrWorkers, bool isPinningThreads)
+	{
+		g_ConfiguredNrWorkers = nrWorkers;
+		g_IsPinningThreads = isPinningThreads;
+	}
+
+	JobSystem& JobSystem::Get()
+	{
+		//The main & raster thread also run jobs while they wait
+		const int nrHardwareThreads{ int(std::thread::hardware_concurrency()) };
+		static JobSystem jobSystem{ g_ConfiguredNrWorkers > 0 ? g_ConfiguredNrWorkers : std::max(1, nrHardwareThreads - 2), g_IsPinningThreads };
+		return jobSystem;
+	}
+
+	void JobSystem::SetNrActiveWorkers(int nrActiveWorkers)
+	{
+		//0: the threads that wait for jobs run all of them
+		m_NrActiveWorkers = std::clamp(nrActiveWorkers, 0, GetNrWorkers());
+		WakeWorkers(true);
+	}
+
+	void JobSystem::Run(Job* pJob)
+	{
+		Push(pJob);
+		WakeWorkers(false);
+	}
+
+	void JobSystem::Wait(const Job* pJob)
+	{
+		const int queueIndex{ GetQueueIndex() };
+		while (pJob->nrUnfinishedJobs.load(std::memory_order_acquire) > 0)
+		{
+			Job* pOtherJob{ PopOrSteal(queueIndex) };
+			if (pOtherJob)
+				Execute(pOtherJob);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	int JobSystem::GetQueueIndex()
+	{
+		if (t_pQueueOwner != this)
+		{
+			//First job of a thread that isn't a worker
+			const int externalIndex{ m_NrExternalThreads++ };
+			assert(externalIndex < m_MaxExternalThreads && "ERROR: too many threads create jobs, raise m_MaxExternalThreads!");
+
+			t_pQueueOwner = this;
+			t_QueueIndex = GetNrWorkers() + externalIndex;
+		}
+		return t_QueueIndex;
+	}
+
+	Job* JobSystem::AllocateJob(Job* pParent)
+	{
+		//Only the owner allocates from its pool, round robin over the slots whose job finished
+		//A finished job isn't read anymore: its waiter saw it finish & Finish read its parent before releasing it
+		const int queueIndex{ GetQueueIndex() };
+		JobQueue& queue{ m_Queues[queueIndex] };
+		Job* pJob{ nullptr };
+		while (!pJob)
+		{
+			for (uint32_t i{ 0 }; i < m_MaxJobsPerThread && !pJob; ++i)
+			{
+				Job* pSlot{ &queue.pJobs[queue.nrAllocatedJobs++ % m_MaxJobsPerThread] };
+				if (pSlot->nrUnfinishedJobs.load(std::memory_order_acquire) == 0)
+					pJob = pSlot;
+			}
+			if (pJob)
+				break;
+
+			//Every job of the pool is still alive, help the others until one finishes
+			Job* pOtherJob{ PopOrSteal(queueIndex) };
+			if (pOtherJob)
+				Execute(pOtherJob);
+			else
+				std::this_thread::yield();
+		}
+
+		pJob->pFunction = nullptr;
+		pJob->pParent = pParent;
+		pJob->nrUnfinishedJobs.store(1, std::memory_order_relaxed);
+		if (pParent)
+			pParent->nrUnfinishedJobs.fetch_add(1, std::memory_order_relaxed);
+
+		return pJob;
+	}
+
+	void JobSystem::Push(Job* pJob)
+	{
+		JobQueue& queue{ m_Queues[GetQueueIndex()] };
+		{
+			std::lock_guard lock{ queue.mutex };
+			assert(queue.back - queue.front < m_MaxJobsPerThread && "ERROR: job queue is full!");
+			queue.ppJobs[queue.back++ % m_MaxJobsPerThread] = pJob;
+			++m_NrQueuedJobs;
+		}
+	}
+
+	void JobSystem::WakeWorkers(bool isWakingAll)
+	{
+		//Taking the lock orders the wake up after the check of a worker that is about to sleep
+		{
+			std::lock_guard lock{ m_SleepMutex };
+		}
+		if (isWakingAll)
+			m_WakeUp.notify_all();
+		else
+			m_WakeUp.notify_one();
+	}
+
+	Job* JobSystem::PopOrSteal(int queueIndex)
+	{
+		if (m_NrQueuedJobs.load(std::memory_order_relaxed) <= 0)
+			return nullptr;
+
+		//Newest job of the own queue first, it's the one with the warmest data
+		{
+			JobQueue& queue{ m_Queues[queueIndex] };
+			std::lock_guard lock{ queue.mutex };
+			if (queue.back != queue.front)
+			{
+				--m_NrQueuedJobs;
+				return queue.ppJobs[--queue.back % m_MaxJobsPerThread];
+			}
+		}
+
+		//Oldest job of another queue, usually the biggest piece of work that's left
+		const int nrQueues{ int(m_Queues.size()) };
+		for (int i{ 1 }; i < nrQueues; ++i)
+		{
+			JobQueue& queue{ m_Queues[(queueIndex + i) % nrQueues] };
+			std::lock_guard lock{ queue.mutex };
+			if (queue.back != queue.front)
+			{
+				--m_NrQueuedJobs;
+				return queue.ppJobs[queue.front++ % m_MaxJobsPerThread];
+			}
+		}
+		return nullptr;
+	}
+
+	void JobSystem::Execute(Job* pJob)
+	{
+		pJob->pFunction(*pJob);
+		Finish(pJob);
+	}
+
+	void JobSystem::Finish(Job* pJob)
+	{
+		//The last child to finish also finishes the parent
+		//The parent is read first, once the count is 0 the owner can reuse the slot
+		Job* pParent{ pJob->pParent };
+		if (pJob->nrUnfinishedJobs.fetch_sub(1, std::memory_order_acq_rel) == 1 && pParent)
+			Finish(pParent);
+	}
+
+	void JobSystem::WorkerLoop(int workerIndex)
+	{
+		t_pQueueOwner = this;
+		t_QueueIndex = workerIndex;
+
+		while (true)
+		{
+			const bool isActive{ workerIndex < m_NrActiveWorkers.load() };
+			Job* pJob{ isActive ? PopOrSteal(workerIndex) : nullptr };
+			if (pJob)
+			{
+				Execute(pJob);
+				continue;
+			}
+
+			std::unique_lock lock{ m_SleepMutex };
+			m_WakeUp.wait(lock, [&]() { return m_IsStopping || (workerIndex < m_NrActiveWorkers.load() && m_NrQueuedJobs.load() > 0); });
+			if (m_IsStopping)
+				return;
+		}
+	}
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "FrameArena.h"
+
+namespace dae
+{
+	// Unit of work of the JobSystem, lives in the job pool of the thread that created it
+	// A job is finished when its function ran and all of its children are finished
+	struct alignas(CacheLineSize) Job
+	{
+		void (*pFunction)(const Job& job);
+		Job* pParent;
+		// Copy of the callable, see JobSystem::CreateJob
+		alignas(16) uint8_t data[96];
+		std::atomic<int32_t> nrUnfinishedJobs;
+	};
+
+	// Persistent worker threads for every parallel stage, no stage starts threads of its own
+	// Every thread that uses it has a deque of jobs: the owner pushes & pops at the back,
+	// idle threads steal from the front of the others
+	// A thread that waits for a job runs other jobs in the meantime, so waiting inside a job never deadlocks
+	class JobSystem final
+	{
+	public:
+		JobSystem(int nrWorkers, bool isPinningThreads);
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem(JobSystem&&) noexcept = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+		JobSystem& operator=(JobSystem&&) noexcept = delete;
+
+		// Settings of the shared job system, only used when they are set before the first Get
+		// nrWorkers <= 0 picks one worker per hardware thread that the main & raster thread don't use
+		static void Configure(int nrWorkers, bool isPinningThreads);
+		static JobSystem& Get();
+
+		// The callable is copied into the job: it has to be trivially copyable and fit in Job::data,
+		// capture big state by reference and keep it alive until the job finished
+		template<typename Function>
+		Job* CreateJob(const Function& function) { return CreateChildJob(nullptr, function); }
+		// pParent doesn't finish before this job, it has to be created but not finished yet
+		template<typename Function>
+		Job* CreateChildJob(Job* pParent, const Function& function)
+		{
+			static_assert(sizeof(Function) <= sizeof(Job::data), "ERROR: job callable doesn't fit in Job::data, capture by reference!");
+			static_assert(alignof(Function) <= 16, "ERROR: job callable is over-aligned!");
+			static_assert(std::is_trivially_copyable_v<Function> && std::is_trivially_destructible_v<Function>,
+				"ERROR: job callable has to be trivially copyable & destructible!");
+
+			Job* pJob{ AllocateJob(pParent) };
+			new(pJob->data) Function{ function };
+			pJob->pFunction = [](const Job& job) { (*reinterpret_cast<const Function*>(job.data))(); };
+			return pJob;
+		}
+
+		// Queues the job on the calling thread's deque and wakes a worker
+		void Run(Job* pJob);
+		// Helps out with other jobs until pJob and its children are finished
+		void Wait(const Job* pJob);
+
+		// function(begin, end) for the ranges [0, count) split in grainSize chunks, returns when all are done
+		// The calling thread works on the chunks too, a range of one chunk runs inline
+		template<typename Function>
+		void ParallelFor(size_t count, size_t grainSize, const Function& function)
+		{
+			if (grainSize == 0)
+				grainSize = 1;
+			if (count <= grainSize)
+			{
+				if (count > 0)
+					function(size_t{ 0 }, count);
+				return;
+			}
+
+			//The pool & queue of this thread hold every chunk with room to spare for the jobs that run while it waits
+			const size_t minGrainSize{ (count + m_MaxChunksPerParallelFor - 1) / m_MaxChunksPerParallelFor };
+			if (grainSize < minGrainSize)
+				grainSize = minGrainSize;
+
+			Job* pRoot{ CreateJob([]() {}) };
+			for (size_t begin{ 0 }; begin < count; begin += grainSize)
+			{
+				const size_t end{ begin + grainSize < count ? begin + grainSize : count };
+				Push(CreateChildJob(pRoot, [&function, begin, end]() { function(begin, end); }));
+			}
+			WakeWorkers(true);
+
+			//The root has nothing to do itself, it only waits for the chunks
+			Finish(pRoot);
+			Wait(pRoot);
+		}
+
+		int GetNrWorkers() const { return int(m_Workers.size()); }
+		// Workers that take jobs, the others sleep - e.g. for the auto-tuner, only between frames
+		int GetNrActiveWorkers() const { return m_NrActiveWorkers.load(); }
+		void SetNrActiveWorkers(int nrActiveWorkers);
+		// Active workers + the thread that waits for jobs, e.g. for sizing per thread work
+		int GetNrThreads() const { return GetNrActiveWorkers() + 1; }
+	private:
+		// Size of the job pool & deque of every thread, slots of finished jobs are recycled round robin
+		static constexpr uint32_t m_MaxJobsPerThread{ 4096 };
+		// Bigger ranges get bigger chunks
+		static constexpr size_t m_MaxChunksPerParallelFor{ m_MaxJobsPerThread / 4 };
+		// Non-worker threads that create jobs: main, raster, ...
+		static constexpr int m_MaxExternalThreads{ 4 };
+
+		struct JobQueue
+		{
+			std::mutex mutex{};
+			// Ring buffer of m_MaxJobsPerThread, [front, back)
+			Job** ppJobs{ nullptr };
+			uint32_t front{};
+			uint32_t back{};
+			// Pool the owner allocates its jobs from
+			Job* pJobs{ nullptr };
+			uint32_t nrAllocatedJobs{};
+		};
+
+		std::vector<std::thread> m_Workers{};
+		// Worker queues first, then the external ones
+		std::vector<JobQueue> m_Queues;
+		std::atomic<int> m_NrExternalThreads{};
+		std::atomic<int> m_NrActiveWorkers{};
+
+		std::mutex m_SleepMutex{};
+		std::condition_variable m_WakeUp{};
+		std::atomic<int32_t> m_NrQueuedJobs{};
+		bool m_IsStopping{ false };
+
+		int GetQueueIndex();
+		Job* AllocateJob(Job* pParent);
+		void Push(Job* pJob);
+		void WakeWorkers(bool isWakingAll);
+		Job* PopOrSteal(int queueIndex);
+		void Execute(Job* pJob);
+		void Finish(Job* pJob);
+		void WorkerLoop(int workerIndex);
+	};
+}
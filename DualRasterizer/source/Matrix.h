@@ -1,60 +1,383 @@
 #pragma once
+#include <cassert>
+#include <cmath>
+#include <span>
+#include "SIMD.h"
 #include "Vector3.h"
 #include "Vector4.h"
+#include "MathHelpers.h"
 
 namespace dae {
 	struct Matrix
 	{
 		Matrix() = default;
-		Matrix(
+		constexpr Matrix(
 			const Vector3& xAxis,
 			const Vector3& yAxis,
 			const Vector3& zAxis,
-			const Vector3& t);
+			const Vector3& t) :
+			Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
+		{
+		}
 
-		Matrix(
+		constexpr Matrix(
 			const Vector4& xAxis,
 			const Vector4& yAxis,
 			const Vector4& zAxis,
-			const Vector4& t);
-
-		Matrix(const Matrix& m);
-
-		Vector3 TransformVector(const Vector3& v) const;
-		Vector3 TransformVector(float x, float y, float z) const;
-		Vector3 TransformPoint(const Vector3& p) const;
-		Vector3 TransformPoint(float x, float y, float z) const;
-
-		Vector4 TransformPoint(const Vector4& p) const;
-		Vector4 TransformPoint(float x, float y, float z, float w) const;
-
-		const Matrix& Transpose();
-		const Matrix& Inverse();
-
-		Vector3 GetAxisX() const;
-		Vector3 GetAxisY() const;
-		Vector3 GetAxisZ() const;
-		Vector3 GetTranslation() const;
-
-		static Matrix CreateTranslation(float x, float y, float z);
-		static Matrix CreateTranslation(const Vector3& t);
-		static Matrix CreateRotationX(float pitch);
-		static Matrix CreateRotationY(float yaw);
-		static Matrix CreateRotationZ(float roll);
-		static Matrix CreateRotation(float pitch, float yaw, float roll);
-		static Matrix CreateRotation(const Vector3& r);
-		static Matrix CreateScale(float sx, float sy, float sz);
-		static Matrix CreateScale(const Vector3& s);
-		static Matrix Transpose(const Matrix& m);
-		static Matrix Inverse(const Matrix& m);
-
-		static Matrix CreateLookAtLH(const Vector3& origin, const Vector3& forward, const Vector3& up);
-		static Matrix CreatePerspectiveFovLH(float fovy, float aspect, float zn, float zf);
-
-		Vector4& operator[](int index);
-		Vector4 operator[](int index) const;
-		Matrix operator*(const Matrix& m) const;
-		const Matrix& operator*=(const Matrix& m);
+			const Vector4& t) :
+			data{ xAxis, yAxis, zAxis, t }
+		{
+		}
+
+		constexpr Matrix(const Matrix& m) = default;
+		constexpr Matrix& operator=(const Matrix& m) = default;
+
+		constexpr Vector3 TransformVector(const Vector3& v) const
+		{
+			return TransformVector(v.x, v.y, v.z);
+		}
+
+		constexpr Vector3 TransformVector(float x, float y, float z) const
+		{
+			return Vector3{
+				data[0].x * x + data[1].x * y + data[2].x * z,
+				data[0].y * x + data[1].y * y + data[2].y * z,
+				data[0].z * x + data[1].z * y + data[2].z * z
+			};
+		}
+
+		constexpr Vector3 TransformPoint(const Vector3& p) const
+		{
+			return TransformPoint(p.x, p.y, p.z);
+		}
+
+		constexpr Vector3 TransformPoint(float x, float y, float z) const
+		{
+			return Vector3{
+				data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
+				data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
+				data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
+			};
+		}
+
+		constexpr Vector4 TransformPoint(const Vector4& p) const
+		{
+			return TransformPoint(p.x, p.y, p.z, p.w);
+		}
+
+		// Full 4D row vector times matrix: the translation row is scaled by w, like the other rows by x, y & z
+		// Was added unscaled before, the same for w = 1 but w = 0 now transforms a direction without the translation
+		constexpr Vector4 TransformPoint(float x, float y, float z, float w) const
+		{
+			if (std::is_constant_evaluated())
+			{
+				return Vector4{
+					data[0].x * x + data[1].x * y + data[2].x * z + data[3].x * w,
+					data[0].y * x + data[1].y * y + data[2].y * z + data[3].y * w,
+					data[0].z * x + data[1].z * y + data[2].z * z + data[3].z * w,
+					data[0].w * x + data[1].w * y + data[2].w * z + data[3].w * w
+				};
+			}
+
+			return Vector4::Store(simd::Combine(data[0].Load(), data[1].Load(), data[2].Load(), data[3].Load(), x, y, z, w));
+		}
+
+		// Batch versions, the rows stay in registers for the whole span
+		// out has to be at least as large as in
+		void TransformPoints(std::span<const Vector3> in, std::span<Vector4> out) const
+		{
+			assert(out.size() >= in.size() && "ERROR: output span is smaller than the input span");
+
+			const simd::Float4 r0{ data[0].Load() };
+			const simd::Float4 r1{ data[1].Load() };
+			const simd::Float4 r2{ data[2].Load() };
+			const simd::Float4 r3{ data[3].Load() };
+
+			for (size_t i{ 0 }; i < in.size(); ++i)
+			{
+				const Vector3& p{ in[i] };
+				simd::Store(&out[i].x, simd::Combine(r0, r1, r2, r3, p.x, p.y, p.z, 1.f));
+			}
+		}
+
+		// Vector3 outputs go through a register sized temporary, a 4-wide store would write past the last element
+		void TransformPoints(std::span<const Vector3> in, std::span<Vector3> out) const
+		{
+			assert(out.size() >= in.size() && "ERROR: output span is smaller than the input span");
+
+			const simd::Float4 r0{ data[0].Load() };
+			const simd::Float4 r1{ data[1].Load() };
+			const simd::Float4 r2{ data[2].Load() };
+			const simd::Float4 r3{ data[3].Load() };
+
+			for (size_t i{ 0 }; i < in.size(); ++i)
+			{
+				const Vector3& p{ in[i] };
+				out[i] = Vector4::Store(simd::Combine(r0, r1, r2, r3, p.x, p.y, p.z, 1.f));
+			}
+		}
+
+		// No translation: the translation row is replaced by zeros instead of multiplied by w = 0
+		void TransformVectors(std::span<const Vector3> in, std::span<Vector3> out) const
+		{
+			assert(out.size() >= in.size() && "ERROR: output span is smaller than the input span");
+
+			const simd::Float4 r0{ data[0].Load() };
+			const simd::Float4 r1{ data[1].Load() };
+			const simd::Float4 r2{ data[2].Load() };
+			const simd::Float4 zero{ simd::Splat(0.f) };
+
+			for (size_t i{ 0 }; i < in.size(); ++i)
+			{
+				const Vector3& v{ in[i] };
+				out[i] = Vector4::Store(simd::Combine(r0, r1, r2, zero, v.x, v.y, v.z, 0.f));
+			}
+		}
+
+		constexpr const Matrix& Transpose()
+		{
+			Matrix result{};
+			for (int r{ 0 }; r < 4; ++r)
+			{
+				for (int c{ 0 }; c < 4; ++c)
+				{
+					result[r][c] = data[c][r];
+				}
+			}
+
+			data[0] = result[0];
+			data[1] = result[1];
+			data[2] = result[2];
+			data[3] = result[3];
+
+			return *this;
+		}
+
+		const Matrix& Inverse()
+		{
+			//Optimized Inverse as explained in FGED1 - used widely in other libraries too.
+			const Vector3& a = data[0];
+			const Vector3& b = data[1];
+			const Vector3& c = data[2];
+			const Vector3& d = data[3];
+
+			const float x = data[0][3];
+			const float y = data[1][3];
+			const float z = data[2][3];
+			const float w = data[3][3];
+
+			Vector3 s = Vector3::Cross(a, b);
+			Vector3 t = Vector3::Cross(c, d);
+			Vector3 u = a * y - b * x;
+			Vector3 v = c * w - d * z;
+
+			const float det = Vector3::Dot(s, v) + Vector3::Dot(t, u);
+			assert((!AreEqual(det, 0.f)) && "ERROR: determinant is 0, there is no INVERSE!");
+			const float invDet = 1.f / det;
+
+			s *= invDet; t *= invDet; u *= invDet; v *= invDet;
+
+			const Vector3 r0 = Vector3::Cross(b, v) + t * y;
+			const Vector3 r1 = Vector3::Cross(v, a) - t * x;
+			const Vector3 r2 = Vector3::Cross(d, u) + s * w;
+			//Vector3 r3 = Vector3::Cross(u, c) - s * z;
+
+			data[0] = Vector4{ r0.x, r1.x, r2.x, 0.f };
+			data[1] = Vector4{ r0.y, r1.y, r2.y, 0.f };
+			data[2] = Vector4{ r0.z, r1.z, r2.z, 0.f };
+			data[3] = {-Vector3::Dot(b, t),Vector3::Dot(a, t),-Vector3::Dot(d, s),Vector3::Dot(c, s) };
+
+			return *this;
+		}
+
+		// Inverse for matrices with 0,0,0,1 as last column (rotation, scale & translation only)
+		// Only inverts the 3x3 part and transforms the translation back, much cheaper than Inverse()
+		const Matrix& InverseAffine()
+		{
+			assert(AreEqual(data[0].w, 0.f) && AreEqual(data[1].w, 0.f) && AreEqual(data[2].w, 0.f) && AreEqual(data[3].w, 1.f)
+				&& "ERROR: InverseAffine needs an affine matrix, use Inverse instead!");
+
+			const Vector3 a{ data[0] };
+			const Vector3 b{ data[1] };
+			const Vector3 c{ data[2] };
+			const Vector3 t{ data[3] };
+
+			const Vector3 bc{ Vector3::Cross(b, c) };
+			const Vector3 ca{ Vector3::Cross(c, a) };
+			const Vector3 ab{ Vector3::Cross(a, b) };
+
+			const float det{ Vector3::Dot(a, bc) };
+			assert((!AreEqual(det, 0.f)) && "ERROR: determinant is 0, there is no INVERSE!");
+			const float invDet{ 1.f / det };
+
+			const Vector3 r0{ bc * invDet };
+			const Vector3 r1{ ca * invDet };
+			const Vector3 r2{ ab * invDet };
+
+			data[0] = Vector4{ r0.x, r1.x, r2.x, 0.f };
+			data[1] = Vector4{ r0.y, r1.y, r2.y, 0.f };
+			data[2] = Vector4{ r0.z, r1.z, r2.z, 0.f };
+			data[3] = Vector4{ -Vector3::Dot(t, r0), -Vector3::Dot(t, r1), -Vector3::Dot(t, r2), 1.f };
+
+			return *this;
+		}
+
+		constexpr Vector3 GetAxisX() const
+		{
+			return data[0];
+		}
+
+		constexpr Vector3 GetAxisY() const
+		{
+			return data[1];
+		}
+
+		constexpr Vector3 GetAxisZ() const
+		{
+			return data[2];
+		}
+
+		constexpr Vector3 GetTranslation() const
+		{
+			return data[3];
+		}
+
+		static constexpr Matrix CreateTranslation(float x, float y, float z)
+		{
+			return CreateTranslation({ x, y, z });
+		}
+
+		static constexpr Matrix CreateTranslation(const Vector3& t)
+		{
+			return { Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, t };
+		}
+
+		static Matrix CreateRotationX(float pitch)
+		{
+			return {
+				{1, 0, 0, 0},
+				{0, std::cos(pitch), -std::sin(pitch), 0},
+				{0, std::sin(pitch), std::cos(pitch), 0},
+				{0, 0, 0, 1}
+			};
+		}
+
+		static Matrix CreateRotationY(float yaw)
+		{
+			return {
+				{std::cos(yaw), 0, -std::sin(yaw), 0},
+				{0, 1, 0, 0},
+				{std::sin(yaw), 0, std::cos(yaw), 0},
+				{0, 0, 0, 1}
+			};
+		}
+
+		static Matrix CreateRotationZ(float roll)
+		{
+			return {
+				{std::cos(roll), std::sin(roll), 0, 0},
+				{-std::sin(roll), std::cos(roll), 0, 0},
+				{0, 0, 1, 0},
+				{0, 0, 0, 1}
+			};
+		}
+
+		static Matrix CreateRotation(float pitch, float yaw, float roll)
+		{
+			return CreateRotation({ pitch, yaw, roll });
+		}
+
+		static Matrix CreateRotation(const Vector3& r)
+		{
+			return CreateRotationX(r[0]) * CreateRotationY(r[1]) * CreateRotationZ(r[2]);
+		}
+
+		static constexpr Matrix CreateScale(float sx, float sy, float sz)
+		{
+			return { {sx, 0, 0}, {0, sy, 0}, {0, 0, sz}, Vector3::Zero };
+		}
+
+		static constexpr Matrix CreateScale(const Vector3& s)
+		{
+			return CreateScale(s[0], s[1], s[2]);
+		}
+
+		static constexpr Matrix Transpose(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.Transpose();
+
+			return out;
+		}
+
+		static Matrix Inverse(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.Inverse();
+
+			return out;
+		}
+
+		static Matrix InverseAffine(const Matrix& m)
+		{
+			Matrix out{ m };
+			out.InverseAffine();
+
+			return out;
+		}
+
+		static Matrix CreateLookAtLH(const Vector3& origin, const Vector3& forward, const Vector3& up)
+		{
+			const Vector3 zAxis{ forward };
+			const Vector3 xAxis{ Vector3::Cross(up, zAxis).Normalized() };
+			const Vector3 yAxis{ Vector3::Cross(zAxis, xAxis) };
+
+			return Matrix{ {xAxis.x, yAxis.x, zAxis.x, 0},
+				{xAxis.y, yAxis.y, zAxis.y, 0} ,
+				{xAxis.z, yAxis.z, zAxis.z, 0 },
+				{ -Vector3::Dot(xAxis, origin), -Vector3::Dot(yAxis, origin), -Vector3::Dot(zAxis, origin), 1} };
+		}
+
+		static constexpr Matrix CreatePerspectiveFovLH(float fov, float aspect, float zn, float zf)
+		{
+			return {
+				{1.f / (aspect * fov), 0.f, 0.f, 0.f},
+				{0.f, 1.f / fov, 0.f, 0.f},
+				{0.f, 0.f, zf / (zf - zn), 1.f},
+				{0.f, 0.f, -(zf * zn) / (zf - zn), 0.f},
+			};
+		}
+
+#pragma region Operator Overloads
+		constexpr Vector4& operator[](int index)
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		constexpr Vector4 operator[](int index) const
+		{
+			assert(index <= 3 && index >= 0);
+			return data[index];
+		}
+
+		// Row r of the result is data[r] transformed by m, same sums as the dot product with the transposed columns
+		constexpr Matrix operator*(const Matrix& m) const
+		{
+			return Matrix{
+				m.TransformPoint(data[0]),
+				m.TransformPoint(data[1]),
+				m.TransformPoint(data[2]),
+				m.TransformPoint(data[3])
+			};
+		}
+
+		constexpr const Matrix& operator*=(const Matrix& m)
+		{
+			*this = *this * m;
+			return *this;
+		}
+#pragma endregion
 
 	private:
 
@@ -72,4 +395,4 @@ namespace dae {
 		// v2x v2y v2z v2w
 		// v3x v3y v3z v3w
 	};
-}
\ No newline at end of file
+}
@@ -7,6 +7,7 @@
 MeshRepresentation::MeshRepresentation(ID3D11Device* pDevice, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, Effect* pEffect)
 	: m_pEffect{ std::move(pEffect) }
 	, m_NumIndices{ 0 }
+	, m_Bounds{ Bounds::FromVertices(vertices) }
 	, m_pIndexBuffer{ nullptr }
 	, m_pInputLayout{ nullptr }
 {
@@ -102,12 +103,28 @@ void MeshRepresentation::Render(ID3D11DeviceContext* pDeviceContext)
 	}
 }
 
-void MeshRepresentation::Update(const dae::Matrix& viewProjectionMatrix, const dae::Matrix& viewInverseMatrix)
+void MeshRepresentation::Update(const dae::Matrix& viewProjectionMatrix, const dae::Matrix& viewInverseMatrix, uint32_t cameraVersion)
 {
-	Matrix worldMatrix = {m_ScaleMatrix * m_RotationMatrix * m_TranslationMatrix};
-	m_pEffect->SetWorldViewProjMatrix(worldMatrix * viewProjectionMatrix);
-	m_pEffect->SetViewInvertMatrix(viewInverseMatrix);
-	m_pEffect->SetWorldMatrix(worldMatrix);
+	const bool isCameraChanged{ !m_HasCameraVersion || cameraVersion != m_CameraVersion };
+	m_HasCameraVersion = true;
+	m_CameraVersion = cameraVersion;
+
+	if (m_IsWorldDirty)
+	{
+		m_WorldMatrix = m_ScaleMatrix * m_RotationMatrix * m_TranslationMatrix;
+		m_pEffect->SetWorldMatrix(m_WorldMatrix);
+	}
+	if (m_IsWorldDirty || isCameraChanged)
+		m_pEffect->SetWorldViewProjMatrix(m_WorldMatrix * viewProjectionMatrix);
+	if (isCameraChanged)
+		m_pEffect->SetViewInvertMatrix(viewInverseMatrix);
+
+	m_IsWorldDirty = false;
+}
+
+bool MeshRepresentation::IsVisible(const dae::Frustum& frustum) const
+{
+	return frustum.IsVisible(m_Bounds, m_WorldMatrix);
 }
 
 void MeshRepresentation::CycleTechnique() const
@@ -117,12 +134,22 @@ void MeshRepresentation::CycleTechnique() const
 
 void MeshRepresentation::RotateY(float angle)
 {
+	if (!m_IsWorldDirty && angle == m_AngleY)
+		return;
+
+	m_AngleY = angle;
 	m_RotationMatrix = Matrix::CreateRotationY(angle);
+	m_IsWorldDirty = true;
 }
 
 void MeshRepresentation::Translation(float x, float y, float z)
 {
+	if (!m_IsWorldDirty && x == m_Translation.x && y == m_Translation.y && z == m_Translation.z)
+		return;
+
+	m_Translation = { x, y, z };
 	m_TranslationMatrix = Matrix::CreateTranslation(x, y, z);
+	m_IsWorldDirty = true;
 }
 
 void MeshRepresentation::PrintFilterMethod() const
@@ -9,8 +9,12 @@ public:
 	~MeshRepresentation();
 
 	void Render(ID3D11DeviceContext* pDeviceContext);
-	void Update(const dae::Matrix& viewProjectionMatrix, const dae::Matrix& viewInverseMatrix);
+	// Only pushes the effect matrices that changed: the world ones after RotateY / Translation changed the transform,
+	// the camera ones when cameraVersion differs from the previous update
+	void Update(const dae::Matrix& viewProjectionMatrix, const dae::Matrix& viewInverseMatrix, uint32_t cameraVersion);
 	void CycleTechnique() const;
+	// Bounds against the frustum with the world transform of the last Update
+	bool IsVisible(const dae::Frustum& frustum) const;
 
 	void RotateY(float angle);
 	void Translation(float x, float y, float z);
@@ -19,6 +23,8 @@ public:
 private:
 	Effect* m_pEffect;
 	uint32_t m_NumIndices;
+	// Object space, from the vertices the buffer was created with
+	Bounds m_Bounds;
 	ID3D11Buffer* m_pVertexBuffer;
 	ID3D11Buffer* m_pIndexBuffer;
 	ID3D11InputLayout* m_pInputLayout;
@@ -26,5 +32,13 @@ private:
 	Matrix m_TranslationMatrix{ Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, Vector3::Zero };
 	Matrix m_RotationMatrix{ Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, Vector3::Zero };
 	Matrix m_ScaleMatrix{ Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, Vector3::Zero };
+
+	// Scale * Rotation * Translation, rebuilt in Update when dirty
+	Matrix m_WorldMatrix{};
+	float m_AngleY{};
+	Vector3 m_Translation{};
+	bool m_IsWorldDirty{ true };
+	bool m_HasCameraVersion{ false };
+	uint32_t m_CameraVersion{};
 };
 
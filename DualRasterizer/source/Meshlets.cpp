@@ -0,0 +1,127 @@
+#include "pch.h"
+#include "Meshlets.h"
+#include <cassert>
+
+namespace dae
+{
+	namespace
+	{
+		constexpr uint32_t NoLocalIndex{ UINT32_MAX };
+
+		// Bounds & normal cone of the last meshlet of the mesh, after its vertices & triangles were added
+		void FinishMeshlet(Mesh& mesh)
+		{
+			Meshlet& meshlet{ mesh.meshlets.back() };
+			const Vertex* pVertices{ mesh.meshletVertices.data() + meshlet.vertexOffset };
+			const uint8_t* pTriangles{ mesh.meshletTriangles.data() + size_t(meshlet.triangleOffset) * 3 };
+
+			meshlet.bounds = Bounds::FromPositions(meshlet.nrVertices, [pVertices](size_t i) -> const Vector3& { return pVertices[i].position; });
+
+			//Face normals with the winding the rasterizer draws, they point towards the camera of a front face
+			//Zero for a triangle without area, it has no direction to face
+			const auto getFaceNormal = [pVertices, pTriangles](uint32_t triangleIdx)
+				{
+					const Vector3& a{ pVertices[pTriangles[triangleIdx * 3 + 0]].position };
+					const Vector3& b{ pVertices[pTriangles[triangleIdx * 3 + 1]].position };
+					const Vector3& c{ pVertices[pTriangles[triangleIdx * 3 + 2]].position };
+					const Vector3 normal{ Vector3::Cross(b - a, c - a) };
+					const float length{ normal.Magnitude() };
+					return length > 0.f ? normal / length : Vector3{};
+				};
+
+			Vector3 normalSum{};
+			for (uint32_t triangleIdx{ 0 }; triangleIdx < meshlet.nrTriangles; ++triangleIdx)
+				normalSum += getFaceNormal(triangleIdx);
+
+			//No common direction, the cone stays at 90 degrees
+			const float sumLength{ normalSum.Magnitude() };
+			if (!(sumLength > 0.f))
+				return;
+
+			const Vector3 axis{ normalSum / sumLength };
+			float minDot{ 1.f };
+			for (uint32_t triangleIdx{ 0 }; triangleIdx < meshlet.nrTriangles; ++triangleIdx)
+			{
+				const Vector3 normal{ getFaceNormal(triangleIdx) };
+				if (normal.SqrMagnitude() > 0.f)
+					minDot = std::min(minDot, Vector3::Dot(normal, axis));
+			}
+
+			if (minDot <= 0.f)
+				return;
+
+			meshlet.coneAxis = axis;
+			meshlet.coneCos = minDot;
+			meshlet.coneSin = sqrtf(std::max(1.f - minDot * minDot, 0.f));
+		}
+	}
+
+	void BuildMeshlets(Mesh& mesh, size_t maxNrVertices, size_t maxNrTriangles)
+	{
+		assert(maxNrVertices >= 3 && maxNrVertices <= 256 && maxNrTriangles >= 1 && "ERROR: a meshlet holds 3 to 256 vertices & at least 1 triangle!");
+
+		mesh.meshlets.clear();
+		mesh.meshletVertices.clear();
+		mesh.meshletTriangles.clear();
+
+		//Index in the current meshlet of every mesh vertex, NoLocalIndex when it isn't in it
+		std::vector<uint32_t> localIndices(mesh.vertices.size(), NoLocalIndex);
+
+		//Original index of every copied vertex of the current meshlet, to reset localIndices when it is closed
+		std::vector<uint32_t> meshletOriginals{};
+		meshletOriginals.reserve(maxNrVertices);
+
+		const auto close = [&]()
+			{
+				FinishMeshlet(mesh);
+				for (const uint32_t original : meshletOriginals)
+					localIndices[original] = NoLocalIndex;
+				meshletOriginals.clear();
+			};
+
+		const bool isStrip{ mesh.primitiveTopology == PrimitiveTopology::TriangleStrip };
+		const size_t increment{ isStrip ? size_t{ 1 } : size_t{ 3 } };
+		for (size_t idx{ 0 }; idx + 2 < mesh.indices.size(); idx += increment)
+		{
+			uint32_t triangle[3]{ mesh.indices[idx + 0], mesh.indices[idx + 1], mesh.indices[idx + 2] };
+			if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0])
+				continue;
+
+			//Odd triangles of a strip have the opposite winding
+			if (isStrip && idx % 2 != 0)
+				std::swap(triangle[1], triangle[2]);
+
+			size_t nrNewVertices{ 0 };
+			for (const uint32_t index : triangle)
+				nrNewVertices += localIndices[index] == NoLocalIndex ? 1 : 0;
+
+			if (mesh.meshlets.empty() ||
+				meshletOriginals.size() + nrNewVertices > maxNrVertices ||
+				mesh.meshlets.back().nrTriangles + 1 > maxNrTriangles)
+			{
+				if (!mesh.meshlets.empty())
+					close();
+
+				Meshlet& meshlet{ mesh.meshlets.emplace_back() };
+				meshlet.vertexOffset = uint32_t(mesh.meshletVertices.size());
+				meshlet.triangleOffset = uint32_t(mesh.meshletTriangles.size() / 3);
+			}
+
+			Meshlet& meshlet{ mesh.meshlets.back() };
+			for (const uint32_t index : triangle)
+			{
+				if (localIndices[index] == NoLocalIndex)
+				{
+					localIndices[index] = meshlet.nrVertices++;
+					meshletOriginals.push_back(index);
+					mesh.meshletVertices.push_back(mesh.vertices[index]);
+				}
+				mesh.meshletTriangles.push_back(uint8_t(localIndices[index]));
+			}
+			++meshlet.nrTriangles;
+		}
+
+		if (!mesh.meshlets.empty())
+			close();
+	}
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include "DataTypes.h"
+
+namespace dae
+{
+	// From software rasterizer
+	// Splits the triangles of mesh in meshlets, fills meshlets, meshletVertices & meshletTriangles of the mesh
+	// Greedy in index order: a meshlet is closed when the next triangle doesn't fit, so it keeps the locality of the index buffer
+	// Degenerate triangles are left out, strips are unrolled with the winding of the software rasterizer
+	void BuildMeshlets(Mesh& mesh, size_t maxNrVertices = 64, size_t maxNrTriangles = 124);
+}
@@ -0,0 +1,82 @@
+﻿#include "pch.h"
+#include "NormalMap.h"
+#include "Vector2.h"
+#include "SoftwareKernels.h"
+#include "JobSystem.h"
+#include <SDL_image.h>
+
+namespace dae
+{
+	NormalMap::NormalMap(int width, int height)
+		: m_Width{ width }
+		, m_Height{ height }
+		, m_Texels(size_t(width) * height)
+	{
+	}
+
+	Vector3 NormalMap::Sample(const Vector2& uv) const
+	{
+		//Same addressing as Texture::Sample
+		const size_t x{ size_t(uv.x * m_Width) };
+		const size_t y{ size_t(uv.y * m_Height) };
+
+		return Decode(m_Texels[x + y * m_Width]);
+	}
+
+	NormalMap* NormalMap::LoadFromFile(const std::string& path)
+	{
+		SDL_Surface* pSurface = IMG_Load(path.c_str());
+		if (pSurface == nullptr)
+			return nullptr;
+
+		NormalMap* pNormalMap = new NormalMap{ pSurface->w, pSurface->h };
+
+		//Surfaces can be 24 or 32 bit, gather the 8-bit RGB of every texel first
+		const size_t nrTexels{ pNormalMap->m_Texels.size() };
+		std::vector<uint8_t> rgb(nrTexels * 3);
+
+		//Rows are independent, blocks of them are converted in parallel
+		SDL_LockSurface(pSurface);
+		JobSystem::Get().ParallelFor(size_t(pSurface->h), m_RowsPerJob, [&](size_t rowBegin, size_t rowEnd)
+			{
+				for (size_t y{ rowBegin }; y < rowEnd; ++y)
+				{
+					const uint8_t* pRow{ static_cast<const uint8_t*>(pSurface->pixels) + y * pSurface->pitch };
+					for (int x{ 0 }; x < pSurface->w; ++x)
+					{
+						Uint32 pixel{};
+						memcpy(&pixel, pRow + x * pSurface->format->BytesPerPixel, pSurface->format->BytesPerPixel);
+
+						uint8_t* pTexel{ &rgb[(x + y * pSurface->w) * 3] };
+						SDL_GetRGB(pixel, pSurface->format, &pTexel[0], &pTexel[1], &pTexel[2]);
+					}
+				}
+
+				//[0, 255] -> [-1, 1], normalize & encode, done once here instead of every sample
+				const size_t texelBegin{ rowBegin * pSurface->w };
+				const size_t texelEnd{ rowEnd * pSurface->w };
+				GetSoftwareKernels().EncodeNormals(rgb.data() + texelBegin * 3, texelEnd - texelBegin, pNormalMap->m_Texels.data() + texelBegin);
+			});
+		SDL_UnlockSurface(pSurface);
+
+		SDL_FreeSurface(pSurface);
+
+		return pNormalMap;
+	}
+
+	Vector3 NormalMap::Decode(uint16_t texel)
+	{
+		const float x{ int8_t(texel & 0xFF) / 127.f };
+		const float y{ int8_t(texel >> 8) / 127.f };
+		const float z{ 1.f - fabsf(x) - fabsf(y) };
+		if (z >= 0.f)
+			return { x, y, z };
+
+		//Unfold the lower hemisphere
+		return {
+			(1.f - fabsf(y)) * (x >= 0.f ? 1.f : -1.f),
+			(1.f - fabsf(x)) * (y >= 0.f ? 1.f : -1.f),
+			z
+		};
+	}
+}
@@ -0,0 +1,50 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include "Vector3.h"
+
+namespace dae
+{
+	struct Vector2;
+
+	// SOFTWARE RASTERIZER
+	// Normal map converted at load time to octahedral encoded, pre-normalized signed vectors
+	// 16 bits per texel instead of the 32-bit surface pixel, no [0, 1] -> [-1, 1] remap when sampling
+	class NormalMap final
+	{
+	public:
+		~NormalMap() = default;
+
+		NormalMap(const NormalMap&) = delete;
+		NormalMap(NormalMap&&) noexcept = delete;
+		NormalMap& operator=(const NormalMap&) = delete;
+		NormalMap& operator=(NormalMap&&) noexcept = delete;
+
+		// Tangent space normal, direction only - normalize after TangentToWorld
+		Vector3 Sample(const Vector2& uv) const;
+		static NormalMap* LoadFromFile(const std::string& path);
+
+		// 3x3 TBN transform, the rows are the tangent space axis in world space
+		static Vector3 TangentToWorld(const Vector3& v, const Vector3& tangent, const Vector3& binormal, const Vector3& normal)
+		{
+			return {
+				tangent.x * v.x + binormal.x * v.y + normal.x * v.z,
+				tangent.y * v.x + binormal.y * v.y + normal.y * v.z,
+				tangent.z * v.x + binormal.z * v.y + normal.z * v.z
+			};
+		}
+	private:
+		NormalMap(int width, int height);
+
+		// Rows per load job
+		static constexpr size_t m_RowsPerJob{ 64 };
+
+		// Encoding is the EncodeNormals software kernel
+		static Vector3 Decode(uint16_t texel);
+
+		int m_Width{};
+		int m_Height{};
+		// Row-major, low byte = x, high byte = y, both snorm8
+		std::vector<uint16_t> m_Texels{};
+	};
+}
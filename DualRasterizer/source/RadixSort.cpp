@@ -0,0 +1,83 @@
+#include "pch.h"
+#include "RadixSort.h"
+#include "FrameArena.h"
+#include "JobSystem.h"
+
+namespace dae
+{
+	namespace
+	{
+		constexpr int DigitBits{ 8 };
+		constexpr size_t NrDigits{ size_t{ 1 } << DigitBits };
+		// Fewer keys per thread than this aren't worth a job
+		constexpr size_t MinKeysPerChunk{ 4096 };
+	}
+
+	void ParallelRadixSort(uint32_t* pKeys, uint32_t* pValues, size_t count, int nrKeyBits, FrameArena& arena)
+	{
+		if (count < 2)
+			return;
+
+		JobSystem& jobSystem{ JobSystem::Get() };
+		const size_t nrChunks{ std::clamp((count + MinKeysPerChunk - 1) / MinKeysPerChunk, size_t{ 1 }, size_t(jobSystem.GetNrThreads())) };
+		const size_t chunkSize{ (count + nrChunks - 1) / nrChunks };
+
+		uint32_t* pHistograms{ arena.Allocate<uint32_t>(nrChunks * NrDigits) };
+		uint32_t* pSourceKeys{ pKeys };
+		uint32_t* pSourceValues{ pValues };
+		uint32_t* pDestinationKeys{ arena.Allocate<uint32_t>(count) };
+		uint32_t* pDestinationValues{ arena.Allocate<uint32_t>(count) };
+
+		for (int shift{ 0 }; shift < nrKeyBits; shift += DigitBits)
+		{
+			//Digit counts per chunk
+			jobSystem.ParallelFor(nrChunks, 1, [&](size_t chunkBegin, size_t chunkEnd)
+				{
+					for (size_t chunk{ chunkBegin }; chunk < chunkEnd; ++chunk)
+					{
+						uint32_t* pHistogram{ pHistograms + chunk * NrDigits };
+						std::fill_n(pHistogram, NrDigits, 0u);
+						for (size_t i{ chunk * chunkSize }; i < std::min(count, (chunk + 1) * chunkSize); ++i)
+							++pHistogram[(pSourceKeys[i] >> shift) & (NrDigits - 1)];
+					}
+				});
+
+			//First destination per chunk & digit: after every smaller digit and after the same digit of the chunks before it,
+			//that keeps the sort stable
+			uint32_t offset{ 0 };
+			for (size_t digit{ 0 }; digit < NrDigits; ++digit)
+			{
+				for (size_t chunk{ 0 }; chunk < nrChunks; ++chunk)
+				{
+					const uint32_t nrKeys{ pHistograms[chunk * NrDigits + digit] };
+					pHistograms[chunk * NrDigits + digit] = offset;
+					offset += nrKeys;
+				}
+			}
+
+			jobSystem.ParallelFor(nrChunks, 1, [&](size_t chunkBegin, size_t chunkEnd)
+				{
+					for (size_t chunk{ chunkBegin }; chunk < chunkEnd; ++chunk)
+					{
+						uint32_t* pHistogram{ pHistograms + chunk * NrDigits };
+						for (size_t i{ chunk * chunkSize }; i < std::min(count, (chunk + 1) * chunkSize); ++i)
+						{
+							const uint32_t destination{ pHistogram[(pSourceKeys[i] >> shift) & (NrDigits - 1)]++ };
+							pDestinationKeys[destination] = pSourceKeys[i];
+							pDestinationValues[destination] = pSourceValues[i];
+						}
+					}
+				});
+
+			std::swap(pSourceKeys, pDestinationKeys);
+			std::swap(pSourceValues, pDestinationValues);
+		}
+
+		//An odd number of passes ends in the scratch
+		if (pSourceKeys != pKeys)
+		{
+			std::copy_n(pSourceKeys, count, pKeys);
+			std::copy_n(pSourceValues, count, pValues);
+		}
+	}
+}
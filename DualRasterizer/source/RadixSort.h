@@ -0,0 +1,13 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace dae
+{
+	class FrameArena;
+
+	// Stable LSD radix sort of pValues by pKeys, both are reordered - 8 bits per pass over the lowest nrKeyBits bits of the keys
+	// The histograms and scatters of a pass run in parallel on the JobSystem, short ranges on the calling thread only
+	// Scratch storage comes from arena
+	void ParallelRadixSort(uint32_t* pKeys, uint32_t* pValues, size_t count, int nrKeyBits, FrameArena& arena);
+}
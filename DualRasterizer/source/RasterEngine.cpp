@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "RasterEngine.h"
+
+namespace dae
+{
+	namespace
+	{
+		// Half-space: the edge functions of every pixel of the row, wins on small & thin triangles
+		int RasterizeHalfSpaceRow(const SoftwareKernels& kernels, const TriangleSetup& setup, int py, int pxBegin, int pxEnd,
+			float* pDepth, Fragment* pFragments)
+		{
+			return kernels.RasterizeRow(setup, py, pxBegin, pxEnd, pDepth, pFragments);
+		}
+
+		// Span: where the edges cross the row gives the covered run, only its pixels are interpolated & depth tested,
+		// wins when the bounding box is mostly empty or the triangle is large
+		int RasterizeSpanRow(const SoftwareKernels& kernels, const TriangleSetup& setup, int py, int pxBegin, int pxEnd,
+			float* pDepth, Fragment* pFragments)
+		{
+			int spanBegin{};
+			int spanEnd{};
+			kernels.FindRowSpan(setup, py, pxBegin, pxEnd, &spanBegin, &spanEnd);
+			if (spanBegin == spanEnd)
+				return 0;
+
+			return kernels.RasterizeInsideRow(setup, py, spanBegin, spanEnd, pDepth + (spanBegin - pxBegin), pFragments);
+		}
+
+		// Reference: pixel by pixel with the math types
+		int RasterizeReferenceRow(const SoftwareKernels&, const TriangleSetup& setup, int py, int pxBegin, int pxEnd,
+			float* pDepth, Fragment* pFragments)
+		{
+			int nrFragments{ 0 };
+			for (int px{ pxBegin }; px < pxEnd; ++px)
+			{
+				const Vector2 point{ float(px) + 0.5f, float(py) + 0.5f };
+
+				//Inside if the point is on the right side of every edge
+				const float signedParallelogramAB{ Vector2::Cross(point - setup.a, setup.ab) };
+				const float signedParallelogramBC{ Vector2::Cross(point - setup.b, setup.bc) };
+				const float signedParallelogramCA{ Vector2::Cross(point - setup.c, setup.ca) };
+				if (!(signedParallelogramAB > 0 && signedParallelogramBC > 0 && signedParallelogramCA > 0))
+					continue;
+
+				const float weightA{ signedParallelogramBC / setup.totalArea };
+				const float weightB{ signedParallelogramCA / setup.totalArea };
+				const float weightC{ signedParallelogramAB / setup.totalArea };
+
+				const float interpolatedDepthZ{ 1 / ((setup.invDepthZA * weightA) + (setup.invDepthZB * weightB) + (setup.invDepthZC * weightC)) };
+				if (interpolatedDepthZ > pDepth[px - pxBegin])
+					continue;
+
+				pDepth[px - pxBegin] = interpolatedDepthZ;
+				pFragments[nrFragments++] = Fragment{ px, weightA, weightB, weightC, interpolatedDepthZ };
+			}
+			return nrFragments;
+		}
+
+		void InterpolateKernelFragments(const SoftwareKernels& kernels, const TriangleVaryings& varyings, const Fragment* pFragments,
+			int nrFragments, int py, Vertex_Out* pVertices)
+		{
+			kernels.InterpolateFragments(varyings, pFragments, nrFragments, py, pVertices);
+		}
+
+		// Reference: fragment by fragment with the math types
+		void InterpolateReferenceFragments(const SoftwareKernels&, const TriangleVaryings& varyings, const Fragment* pFragments,
+			int nrFragments, int py, Vertex_Out* pVertices)
+		{
+			for (int i{ 0 }; i < nrFragments; ++i)
+			{
+				const Fragment& fragment{ pFragments[i] };
+
+				//Divide each attribute by the original vertex depth - w already holds 1 / Vw
+				const float weightA{ fragment.weightA * varyings.invDepthW[0] };
+				const float weightB{ fragment.weightB * varyings.invDepthW[1] };
+				const float weightC{ fragment.weightC * varyings.invDepthW[2] };
+				const float interpolatedDepthW{ 1 / (weightA + weightB + weightC) };
+
+				Vertex_Out& vertOut{ pVertices[i] };
+				vertOut.position = { float(fragment.px), float(py), fragment.depthZ, interpolatedDepthW };
+
+				if (varyings.pUV[0])
+					vertOut.uv = (*varyings.pUV[0] * weightA + *varyings.pUV[1] * weightB + *varyings.pUV[2] * weightC) * interpolatedDepthW;
+				if (varyings.pNormal[0])
+					vertOut.normal = (*varyings.pNormal[0] * weightA + *varyings.pNormal[1] * weightB + *varyings.pNormal[2] * weightC).Normalized();
+				if (varyings.pTangent[0])
+					vertOut.tangent = (*varyings.pTangent[0] * weightA + *varyings.pTangent[1] * weightB + *varyings.pTangent[2] * weightC).Normalized();
+				if (varyings.pViewDirection[0])
+					vertOut.viewDirection = (*varyings.pViewDirection[0] * weightA + *varyings.pViewDirection[1] * weightB + *varyings.pViewDirection[2] * weightC).Normalized();
+			}
+		}
+
+		constexpr RasterEngine g_RasterEngines[]{
+			{ "HALF-SPACE", true, &RasterizeHalfSpaceRow },
+			{ "SPAN", true, &RasterizeSpanRow },
+			{ "REFERENCE", false, &RasterizeReferenceRow }
+		};
+
+		constexpr ShadingEngine g_ShadingEngines[]{
+			{ "KERNELS", &InterpolateKernelFragments },
+			{ "REFERENCE", &InterpolateReferenceFragments }
+		};
+
+		template<typename Engine>
+		const Engine* FindEngine(std::span<const Engine> engines, std::string_view name)
+		{
+			for (const Engine& engine : engines)
+			{
+				if (name == engine.pName)
+					return &engine;
+			}
+			return nullptr;
+		}
+	}
+
+	std::span<const RasterEngine> GetRasterEngines()
+	{
+		return g_RasterEngines;
+	}
+
+	std::span<const ShadingEngine> GetShadingEngines()
+	{
+		return g_ShadingEngines;
+	}
+
+	const RasterEngine* FindRasterEngine(std::string_view name)
+	{
+		return FindEngine(GetRasterEngines(), name);
+	}
+
+	const ShadingEngine* FindShadingEngine(std::string_view name)
+	{
+		return FindEngine(GetShadingEngines(), name);
+	}
+}
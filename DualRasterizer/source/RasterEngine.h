@@ -0,0 +1,36 @@
+#pragma once
+#include <span>
+#include <string_view>
+#include "SoftwareKernels.h"
+
+namespace dae
+{
+	// How the software raster stage finds the covered pixels of a triangle row, switchable at runtime
+	// Every engine has the contract of SoftwareKernels::RasterizeRow: same coverage under the same fill rule,
+	// same depth & fragments, so only their speed differs
+	struct RasterEngine
+	{
+		const char* pName;
+		// Tiny triangles per pixel & inside blocks of large ones without the engine, false runs every row through RasterizeRow
+		bool isUsingFastPaths;
+		int (*RasterizeRow)(const SoftwareKernels& kernels, const TriangleSetup& setup, int py, int pxBegin, int pxEnd,
+			float* pDepth, Fragment* pFragments);
+	};
+
+	// How the live varyings of the fragments are interpolated for the pixel shader,
+	// the contract of SoftwareKernels::InterpolateFragments
+	struct ShadingEngine
+	{
+		const char* pName;
+		void (*InterpolateFragments)(const SoftwareKernels& kernels, const TriangleVaryings& varyings, const Fragment* pFragments,
+			int nrFragments, int py, Vertex_Out* pVertices);
+	};
+
+	// Registries, the first engine is the default
+	// "REFERENCE" is a plain scalar loop without kernels, the one every optimized engine is validated against
+	std::span<const RasterEngine> GetRasterEngines();
+	std::span<const ShadingEngine> GetShadingEngines();
+	// nullptr when no engine has that name
+	const RasterEngine* FindRasterEngine(std::string_view name);
+	const ShadingEngine* FindShadingEngine(std::string_view name);
+}
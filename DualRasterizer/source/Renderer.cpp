@@ -4,6 +4,16 @@
 #include "Utils.h"
 #include "FullShaderEffect.h"
 #include "Texture.h"
+#include "FrameArena.h"
+#include "FrameBuffer.h"
+#include "SoftwarePresenter.h"
+#include "AllocationCounter.h"
+#include "SoftwareKernels.h"
+#include "JobSystem.h"
+#include "RadixSort.h"
+#include "RasterEngine.h"
+#include "Meshlets.h"
+#include <cassert>
 
 // TEXT COLORS
 #define RESET   "\033[0m" 
@@ -13,11 +23,59 @@
 
 namespace dae {
 
-	Renderer::Renderer(SDL_Window* pWindow) :
+	namespace
+	{
+		// Raster path of a triangle, picked at setup from the number of pixel centers in its bounding box
+		enum class TriangleClass : uint8_t
+		{
+			Tiny,		//A few pixels, each tested on its own
+			Regular,	//Row by row per block
+			Large		//Blocks classified first: outside ones are skipped, inside ones skip the coverage test
+		};
+
+		// Triangle that passed culling, with everything the tiles need to rasterize it
+		struct BinnedTriangle
+		{
+			TriangleSetup setup;
+			TriangleVaryings varyings;
+			// Clamped bounding box in pixels, [begin, end)
+			int pxBegin, pyBegin, pxEnd, pyEnd;
+			// Conservative bounds of the depth of every covered pixel, for the compressed depth blocks
+			float minDepth, maxDepth;
+			TriangleClass triangleClass;
+		};
+
+		// Rows [pyBegin, pyEnd) of a tile, a whole tile unless it was split
+		struct TileWork
+		{
+			uint32_t tileIdx;
+			int pyBegin, pyEnd;
+			float cost;
+		};
+
+		// Calls function(tileIdx) for every tile the bounding box overlaps, nrTilesX tiles per row
+		template<typename Function>
+		void ForEachTile(const BinnedTriangle& triangle, int tileSize, int nrTilesX, const Function& function)
+		{
+			const int tileXEnd{ (triangle.pxEnd - 1) / tileSize + 1 };
+			const int tileYEnd{ (triangle.pyEnd - 1) / tileSize + 1 };
+			for (int tileY{ triangle.pyBegin / tileSize }; tileY < tileYEnd; ++tileY)
+			{
+				for (int tileX{ triangle.pxBegin / tileSize }; tileX < tileXEnd; ++tileX)
+					function(size_t(tileX) + size_t(tileY) * nrTilesX);
+			}
+		}
+	}
+
+	Renderer::Renderer(SDL_Window* pWindow, int presentQueueDepth) :
 		m_pWindow(pWindow)
 	{
 		// UNI INITIALIZE
 		SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
+		// SDL_image loads its PNG decoder on first use and that isn't thread-safe,
+		// it is loaded here on the main thread before any texture job decodes in parallel - IMG_Quit in the destructor
+		if ((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0)
+			std::cout << "SDL_image PNG support failed to initialize: " << IMG_GetError() << "\n";
 		// CAMERA
 		m_Camera.Initialize(45.f, { 0.f, 0.f, 0.f }, (float)m_Width / m_Height);
 
@@ -73,25 +131,56 @@ namespace dae {
 		// -----------------------------------
 
 		//Create Buffers
-		m_pFrontBuffer = SDL_GetWindowSurface(pWindow);
-		m_pBackBuffer = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
-		m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
+		//The software rasterizer renders straight into the buffers it presents, uploaded to the D3D swap chain when there is one
+		//Presenting happens on its own thread, at most presentQueueDepth finished frames wait for it
+		//Without D3D the main thread copies them to the window surface in Render instead
+		if (m_IsInitialized)
+			m_pSoftwarePresenter = new SoftwarePresenter{ pWindow, m_Width, m_Height, presentQueueDepth, m_pDeviceContext, m_pSwapChain, m_pRenderTargetBuffer };
+		else
+			m_pSoftwarePresenter = new SoftwarePresenter{ pWindow, m_Width, m_Height, presentQueueDepth, nullptr, nullptr, nullptr };
 
-		m_pDepthBufferPixels = new float[m_Width * m_Height];
+		m_pFrameBuffer = new FrameBuffer{ m_Width, m_Height };
 
-		m_pDiffuseTexture = Texture::LoadFromFile("Resources/vehicle_diffuse.png");		// Texture diffuse of the vehicle
-		m_pNormalTexture = Texture::LoadFromFile("Resources/vehicle_normal.png");			// Normal map of the vehicle
-		m_pGlossTexture = Texture::LoadFromFile("Resources/vehicle_gloss.png");			// Gloss map of the vehicle
-		m_pSpecularTexture = Texture::LoadFromFile("Resources/vehicle_specular.png");		// Specular map of the vehicle
+		//The files are decoded in parallel, one job per texture
+		JobSystem& jobSystem{ JobSystem::Get() };
+		Job* pLoadTextures{ jobSystem.CreateJob([]() {}) };
+		jobSystem.Run(jobSystem.CreateChildJob(pLoadTextures, [this]() { m_pDiffuseTexture = Texture::LoadFromFile("Resources/vehicle_diffuse.png"); }));		// Texture diffuse of the vehicle
+		jobSystem.Run(jobSystem.CreateChildJob(pLoadTextures, [this]() { m_pNormalMap = NormalMap::LoadFromFile("Resources/vehicle_normal.png"); }));			// Normal map of the vehicle
+		jobSystem.Run(jobSystem.CreateChildJob(pLoadTextures, [this]() { m_pGlossTexture = Texture::LoadFromFile("Resources/vehicle_gloss.png"); }));			// Gloss map of the vehicle
+		jobSystem.Run(jobSystem.CreateChildJob(pLoadTextures, [this]() { m_pSpecularTexture = Texture::LoadFromFile("Resources/vehicle_specular.png"); }));		// Specular map of the vehicle
+		jobSystem.Run(pLoadTextures);
 
 		Mesh& vehicleMesh = m_SoftwareMeshes.emplace_back(Mesh{});
 		vehicleMesh.primitiveTopology = PrimitiveTopology::TriangleList;
 		Utils::ParseOBJ("Resources/vehicle.obj", vehicleMesh.vertices, vehicleMesh.indices);
+		vehicleMesh.bounds = Bounds::FromVertices(vehicleMesh.vertices);
+		BuildMeshlets(vehicleMesh);
+
+		jobSystem.Wait(pLoadTextures);
+
+		//Every frame snapshot has a slot per mesh, the raster thread starts once they exist
+		for (SoftwareFrame& frame : m_SoftwareFrames)
+			frame.meshes.resize(m_SoftwareMeshes.size());
+		m_RasterThread = std::thread{ &Renderer::RasterThreadLoop, this };
+
+		//Settings of an earlier auto-tune on this host, --isa= still forces the kernel level
+		TuningConfig tuningConfig{};
+		if (AutoTuner::Load(AutoTuner::GetHostFingerprint(m_Width, m_Height), tuningConfig))
+		{
+			if (CpuFeatures::HasOverride())
+				tuningConfig.level = GetSoftwareKernels().level;
+			ApplyTuningConfig(tuningConfig);
+			std::cout << "Auto-tuned settings loaded: " << tuningConfig.tileSize << " px tiles, "
+				<< JobSystem::Get().GetNrActiveWorkers() << " workers\n";
+		}
 
 		// -----------------------------------
 		// X INFORMATION
 		// -----------------------------------
 
+		std::cout << "Software kernels: " << CpuFeatures::GetName(GetSoftwareKernels().level)
+			<< " (CPU supports " << CpuFeatures::GetName(CpuFeatures::GetSupportedLevel()) << ")\n\n";
+
 		std::cout << YELLOW << "[Key bindings - SHARED]\n";
 		std::cout << "    [F1]  Toggle Rasterizer Mode (HARDWARE/SOFTWARE)\n";
 		std::cout << "    [F2]  Toggle Vehicle Rotation (ON/OFF)\n";
@@ -104,12 +193,33 @@ namespace dae {
 		std::cout << "    [F5]  Cycle Shading Mode (COMBINED/OBSERVED_AREA/DIFFUSE/SPECULAR)\n";
 		std::cout << "    [F6]  Toggle NormalMap (ON/OFF)\n";
 		std::cout << "    [F7]  Toggle DepthBuffer Visualization (ON/OFF)\n";
-		std::cout << "    [F8]  Toggle BoundingBox Visualization (ON/OFF)\n\n";
+		std::cout << "    [Shift + F7] Toggle Depth Compression (ON/OFF)\n";
+		std::cout << "    [F8]  Toggle BoundingBox Visualization (ON/OFF)\n";
+		std::cout << "    [Shift + F8] Toggle Front-to-Back Triangle Sorting (ON/OFF)\n";
+		std::cout << "    [Ctrl + F8] Toggle Meshlet Culling (ON/OFF)\n";
+		std::cout << "    [F9]  Auto-Tune Kernels, Tile Size & Workers\n";
+		std::cout << "    [Shift + F9] Toggle Deterministic Schedule (ON/OFF)\n";
+		std::cout << "    [Ctrl + F9] Check Determinism over 1..N Threads\n";
+		std::cout << "    [F12] Cycle Raster Engine (HALF-SPACE/SPAN/REFERENCE)\n";
+		std::cout << "    [Shift + F12] Cycle Shading Engine (KERNELS/REFERENCE)\n";
+		std::cout << "    [Ctrl + F12] Validate Engines against REFERENCE\n\n";
 		std::cout << RESET;
 	}
 
 	Renderer::~Renderer()
 	{
+		// Stops the raster thread first, it presents through the presenter
+		{
+			std::lock_guard lock{ m_SoftwareFrameMutex };
+			m_IsStoppingRasterThread = true;
+		}
+		m_SoftwareFrameChanged.notify_all();
+		if (m_RasterThread.joinable())
+			m_RasterThread.join();
+
+		// Stops the present thread before the device context it uses is released
+		delete m_pSoftwarePresenter;
+
 		// DirectX
 		for(auto& mesh : m_pHardwareMeshes)
 		{
@@ -131,11 +241,13 @@ namespace dae {
 		if (m_pDevice) m_pDevice->Release();
 
 		// Software Rasterizer
-		delete[] m_pDepthBufferPixels;
+		delete m_pFrameBuffer;
 		delete m_pDiffuseTexture;
-		delete m_pNormalTexture;
+		delete m_pNormalMap;
 		delete m_pGlossTexture;
 		delete m_pSpecularTexture;
+
+		IMG_Quit();
 	}
 
 	void Renderer::Update(const Timer* pTimer)
@@ -157,6 +269,9 @@ namespace dae {
 			RenderHardwareRasterizer();
 		else
 			RenderSoftwareRasterizer();
+
+		//Without D3D the finished software frames are copied to the window surface here, SDL wants that on the main thread
+		m_pSoftwarePresenter->PresentToWindow();
 	}
 
 	// RENDER
@@ -179,6 +294,10 @@ namespace dae {
 			if (mesh == m_pMeshFire && !m_FireFXMeshEnabled)
 				break;
 
+			//Meshes outside the frustum never reach the input assembler
+			if (!mesh->IsVisible(m_Camera.GetFrustum()))
+				continue;
+
 			mesh->Render(m_pDeviceContext);
 		}
 
@@ -188,30 +307,244 @@ namespace dae {
 	void Renderer::RenderSoftwareRasterizer()
 	{
 		//@START
-		//Lock BackBuffer
-		SDL_LockSurface(m_pBackBuffer);
+		//Frame n reuses the snapshot of frame n - 2, wait until the raster thread is done with it
+		const uint64_t frameNumber{ m_NrSubmittedSoftwareFrames };
+		{
+			std::unique_lock lock{ m_SoftwareFrameMutex };
+			m_SoftwareFrameChanged.wait(lock, [&]() { return m_NrRasterizedSoftwareFrames + m_NrSoftwareFrames > frameNumber; });
+		}
+		SoftwareFrame& frame{ m_SoftwareFrames[frameNumber % m_NrSoftwareFrames] };
+
+		const uint64_t vertexStart{ SDL_GetPerformanceCounter() };
+		const size_t nrArenaGrowthsAtStart{ frame.arena.GetNrGrowths() };
+		const uint64_t nrAllocationsAtStart{ AllocationCounter::GetCount() };
+
+		PrepareSoftwareFrame(frame);
+
+		m_SoftwareVertexCounts += SDL_GetPerformanceCounter() - vertexStart;
 
+		//Steady state: no thread allocates from the heap, arena blocks aren't counted
+		assert(AllocationCounter::GetCount() == nrAllocationsAtStart && "ERROR: heap allocation in the software frame loop, allocate from the FrameArena instead!");
+#if defined(_DEBUG)
+		//Growing is expected while the arena warms up to the largest frame, reported so it doesn't go unnoticed
+		if (frame.arena.GetNrGrowths() != nrArenaGrowthsAtStart)
+			std::cout << PURPLE << "**(SOFTWARE) Vertex stage FrameArena grew to " << frame.arena.GetCapacity() / 1024 << " KB\n" << RESET;
+#endif
+
+		//Hand the frame to the raster thread, the main thread continues with the update of the next one
+		{
+			std::lock_guard lock{ m_SoftwareFrameMutex };
+			++m_NrSubmittedSoftwareFrames;
+		}
+		m_SoftwareFrameChanged.notify_all();
+	}
+	void Renderer::PrepareSoftwareFrame(SoftwareFrame& frame)
+	{
+		//SNAPSHOT
+		//Everything the raster thread reads of this frame, the main thread can change the originals right after
+		frame.viewMatrix = m_Camera.viewMatrix;
+		frame.projectionMatrix = m_Camera.projectionMatrix;
+		frame.frustum = m_Camera.frustum;
+		frame.cameraOrigin = m_Camera.origin;
+
+		frame.lightingMode = m_CurrentLightingMode;
+		//Only the attributes the current shading mode reads are transformed and interpolated
+		frame.liveVaryings = GetLiveVaryings();
 		//Clear the BackBuffer not in 255 but [0, 1]
-		ColorRGB clearColor{ .39f, .39f, .39f };
-		if (m_ClearColorEnabled)
-			clearColor = ColorRGB{ .1f, .1f, .1f };
+		frame.clearColor = m_ClearColorEnabled ? ColorRGB{ .1f, .1f, .1f } : ColorRGB{ .39f, .39f, .39f };
+		frame.isNormalMapEnabled = m_NormalMapEnabled;
+		frame.isDepthBufferEnabled = m_DepthBufferEnabled;
+		frame.isDepthCompressed = m_DepthCompressionEnabled;
+		frame.isTriangleSortEnabled = m_TriangleSortEnabled;
+		frame.isMeshletCullingEnabled = m_MeshletCullingEnabled;
+		frame.isDeterministic = m_DeterministicEnabled;
+		frame.pRasterEngine = &GetRasterEngines()[m_RasterEngineIdx];
+		frame.pShadingEngine = &GetShadingEngines()[m_ShadingEngineIdx];
+		frame.isBoundingBoxVisualizationEnabled = m_BoundingBoxVisualizationEnabled;
+
+		//The streams of frame n - 2 aren't read anymore
+		frame.arena.Reset();
+		VertexTransformationFunctionW3(m_SoftwareMeshes, frame);
+	}
+	void Renderer::RasterizeSoftwareFrame(const SoftwareFrame& frame, bool isPresented)
+	{
+		//All temporaries of the raster stage come from the frame arena of the raster thread
+		FrameArena& frameArena{ FrameArena::GetThreadArena() };
+		const size_t nrArenaGrowthsAtStart{ frameArena.GetNrGrowths() };
+		const uint64_t nrAllocationsAtStart{ AllocationCounter::GetCount() };
+
+		const uint64_t rasterStart{ SDL_GetPerformanceCounter() };
+
+		//No full screen fills: color & depth of a tile are cleared when a triangle first touches it,
+		//the tiles nothing touched get the clear color in Resolve
+		//Color & depth are rendered in 8x8 blocks, Resolve writes them row after row in the presented buffer
+		m_pFrameBuffer->BeginFrame(m_pSoftwarePresenter->GetBackBuffer(), FrameBuffer::PackColor(frame.clearColor), frame.isDepthCompressed);
+		uint32_t* pBackBufferPixels{ m_pFrameBuffer->GetColor() };
+		float* pDepthBufferPixels{ m_pFrameBuffer->GetDepth() };
+
+		const bool isUVLive{ HasVarying(frame.liveVaryings, Varying::UV) };
+		const bool isNormalLive{ HasVarying(frame.liveVaryings, Varying::Normal) };
+		const bool isTangentLive{ HasVarying(frame.liveVaryings, Varying::Tangent) };
+		const bool isViewDirectionLive{ HasVarying(frame.liveVaryings, Varying::ViewDirection) };
+
+		//Hot loops run in the kernels of the best ISA level of this CPU
+		const SoftwareKernels& kernels{ GetSoftwareKernels() };
+		const RasterEngine& rasterEngine{ *frame.pRasterEngine };
+		const ShadingEngine& shadingEngine{ *frame.pShadingEngine };
+
+		//ORDERING
+		//Opaque geometry is drawn front to back: near surfaces fill the depth first, hidden fragments then fail before shading
+		//Meshes by the view depth of their origin, the triangles of a mesh in clusters after binning
+		const size_t nrMeshes{ m_SoftwareMeshes.size() };
+		uint32_t* pMeshOrder{ frameArena.Allocate<uint32_t>(nrMeshes) };
+		float* pMeshDepths{ frameArena.Allocate<float>(nrMeshes) };
+		for (size_t meshIdx{ 0 }; meshIdx < nrMeshes; ++meshIdx)
+		{
+			pMeshOrder[meshIdx] = uint32_t(meshIdx);
+			pMeshDepths[meshIdx] = frame.viewMatrix.TransformPoint(frame.meshes[meshIdx].worldMatrix.GetTranslation()).z;
+		}
+		std::stable_sort(pMeshOrder, pMeshOrder + nrMeshes, [pMeshDepths](uint32_t a, uint32_t b) { return pMeshDepths[a] < pMeshDepths[b]; });
+
+		//BINNING
+		//Setup of every visible triangle, meshes in draw order & triangles in index order, and the list of triangles per screen tile
+		size_t maxNrTriangles{ 0 };
+		for (const Mesh& mesh : m_SoftwareMeshes)
+			maxNrTriangles += mesh.indices.size();
+		BinnedTriangle* pTriangles{ frameArena.Allocate<BinnedTriangle>(maxNrTriangles) };
+		size_t nrTriangles{ 0 };
+
+		//Triangles are binned in the tiles of the frame buffer, the tile size is tunable
+		const int tileSize{ m_pFrameBuffer->GetTileSize() };
+		const int nrTilesX{ m_pFrameBuffer->GetNrTilesX() };
+		const int nrTilesY{ m_pFrameBuffer->GetNrTilesY() };
+		const size_t nrTiles{ size_t(nrTilesX) * nrTilesY };
+		uint32_t* pBinOffsets{ frameArena.Allocate<uint32_t>(nrTiles + 1) };
+		std::fill(pBinOffsets, pBinOffsets + nrTiles + 1, 0u);
+
+		//Depth range of the binned triangles, the range the cluster depths are quantized in
+		float minFrameDepth{ FLT_MAX };
+		float maxFrameDepth{ 0.f };
+
+		//Culling, setup & binning of one triangle, the indices are in the streams of meshFrame
+		const auto binTriangle = [&](const MeshFrame& meshFrame, uint32_t idxA, uint32_t idxB, uint32_t idxC)
+			{
+				const Vector4* pPositions{ meshFrame.positions_out.data() };
 
-		clearColor *= 255.f;
+				//Only the hot position stream is touched until a pixel is covered
+				const Vector4& positionA = pPositions[idxA];
+				const Vector4& positionB = pPositions[idxB];
+				const Vector4& positionC = pPositions[idxC];
 
-		uint32_t hexColor = 0xFF000000 | (uint32_t)clearColor.b << 8 | (uint32_t)clearColor.g << 16 | (uint32_t)clearColor.r;
-		SDL_FillRect(m_pBackBuffer, NULL, hexColor);
+				//Frustum Culling
+				//x & y are already in raster space - check if they are inside [0, width] & [0, height], z inside [0, 1] => DirectX convention
+				if ((positionA.x < 0.f || positionA.x > float(m_Width)) &&
+					(positionB.x < 0.f || positionB.x > float(m_Width)) &&
+					(positionC.x < 0.f || positionC.x > float(m_Width)))
+					return;
+				if ((positionA.y < 0.f || positionA.y > float(m_Height)) &&
+					(positionB.y < 0.f || positionB.y > float(m_Height)) &&
+					(positionC.y < 0.f || positionC.y > float(m_Height)))
+					return;
+				if (positionA.z < 0.f || positionA.z > 1.f ||
+					positionB.z < 0.f || positionB.z > 1.f ||
+					positionC.z < 0.f || positionC.z > 1.f)
+					return;
 
-		//std::fill_n EXPLAINED
-		//1st parameter: beginning of the range of elements to modify
-		//2nd parameter: number of elements to be modified
-		//3rd parameter: the value to be assigned
-		std::fill_n(m_pDepthBufferPixels, m_Width * m_Height, FLT_MAX);
+				//Get the bounding box TOP LEFT point
+				Vector2 boundingBoxMin{};
+				boundingBoxMin.x = std::min(positionA.x, std::min(positionB.x, positionC.x));
+				boundingBoxMin.y = std::min(positionA.y, std::min(positionB.y, positionC.y));
+				//Clamp is needed otherwise the image will repeat itself
+				boundingBoxMin.x = Clamp(boundingBoxMin.x, 0.f, float(m_Width));
+				boundingBoxMin.y = Clamp(boundingBoxMin.y, 0.f, float(m_Height));
+				//Get the bounding box LOWER RIGHT point
+				Vector2 boundingBoxMax{};
+				boundingBoxMax.x = std::max(positionA.x, std::max(positionB.x, positionC.x));
+				boundingBoxMax.y = std::max(positionA.y, std::max(positionB.y, positionC.y));
+				//Clamp is needed otherwise the image will repeat itself
+				boundingBoxMax.x = Clamp(boundingBoxMax.x, 0.f, float(m_Width));
+				boundingBoxMax.y = Clamp(boundingBoxMax.y, 0.f, float(m_Height));
 
-		VertexTransformationFunctionW3(m_SoftwareMeshes);
+				BinnedTriangle& triangle{ pTriangles[nrTriangles] };
+
+				//Pixel range: only the pixels whose center px + 0.5 is inside the bounding box can be covered
+				//A sub-pixel triangle between pixel centers ends up empty and is culled here
+				triangle.pxBegin = int(ceilf(boundingBoxMin.x - 0.5f));
+				triangle.pxEnd = int(floorf(boundingBoxMax.x - 0.5f)) + 1;
+				triangle.pyBegin = int(ceilf(boundingBoxMin.y - 0.5f));
+				triangle.pyEnd = int(floorf(boundingBoxMax.y - 0.5f)) + 1;
+				if (triangle.pxBegin >= triangle.pxEnd || triangle.pyBegin >= triangle.pyEnd)
+					return;
+
+				const int nrSamplesX{ triangle.pxEnd - triangle.pxBegin };
+				const int nrSamplesY{ triangle.pyEnd - triangle.pyBegin };
+				if (nrSamplesX * nrSamplesY <= m_MaxTinyTriangleSamples)
+					triangle.triangleClass = TriangleClass::Tiny;
+				else if (nrSamplesX >= m_MinLargeTriangleSize && nrSamplesY >= m_MinLargeTriangleSize)
+					triangle.triangleClass = TriangleClass::Large;
+				else
+					triangle.triangleClass = TriangleClass::Regular;
+
+				//Edge functions and reciprocal depths, the same for every pixel of the triangle
+				TriangleSetup& setup{ triangle.setup };
+				setup.a = positionA.GetXY();
+				setup.b = positionB.GetXY();
+				setup.c = positionC.GetXY();
+				//Make vectors [AB], [BC] & [CB]
+				setup.ab = setup.a - setup.b;
+				setup.bc = setup.b - setup.c;
+				setup.ca = setup.c - setup.a;
+				//Get the total area of the triangle - '-CA' to have [AB] X [AC]
+				setup.totalArea = Vector2::Cross(setup.ab, -setup.ca);
+				setup.invDepthZA = 1 / positionA.z;
+				setup.invDepthZB = 1 / positionB.z;
+				setup.invDepthZC = 1 / positionC.z;
+
+				//The interpolated depth of a covered pixel is a weighted harmonic mean of the corners, so it lies in their range
+				triangle.minDepth = std::min(positionA.z, std::min(positionB.z, positionC.z)) * (1.f - m_DepthBoundsMargin);
+				triangle.maxDepth = std::max(positionA.z, std::max(positionB.z, positionC.z)) * (1.f + m_DepthBoundsMargin);
+
+				//Cold attribute streams, only read for covered pixels
+				triangle.varyings = {
+					{ positionA.w, positionB.w, positionC.w },
+					{ isUVLive ? &meshFrame.uvs_out[idxA] : nullptr, isUVLive ? &meshFrame.uvs_out[idxB] : nullptr, isUVLive ? &meshFrame.uvs_out[idxC] : nullptr },
+					{ isNormalLive ? &meshFrame.normals_out[idxA] : nullptr, isNormalLive ? &meshFrame.normals_out[idxB] : nullptr, isNormalLive ? &meshFrame.normals_out[idxC] : nullptr },
+					{ isTangentLive ? &meshFrame.tangents_out[idxA] : nullptr, isTangentLive ? &meshFrame.tangents_out[idxB] : nullptr, isTangentLive ? &meshFrame.tangents_out[idxC] : nullptr },
+					{ isViewDirectionLive ? &meshFrame.viewDirections_out[idxA] : nullptr, isViewDirectionLive ? &meshFrame.viewDirections_out[idxB] : nullptr, isViewDirectionLive ? &meshFrame.viewDirections_out[idxC] : nullptr }
+				};
+				minFrameDepth = std::min(minFrameDepth, triangle.minDepth);
+				maxFrameDepth = std::max(maxFrameDepth, triangle.maxDepth);
+				++nrTriangles;
+
+				//Count per tile first, the bins are filled once their sizes are known
+				ForEachTile(triangle, tileSize, nrTilesX, [&](size_t tileIdx) { ++pBinOffsets[tileIdx + 1]; });
+			};
 
 		//Iterates over every mesh
-		for (auto& mesh : m_SoftwareMeshes)
+		for (size_t orderIdx{ 0 }; orderIdx < nrMeshes; ++orderIdx)
 		{
+			const size_t meshIdx{ pMeshOrder[orderIdx] };
+			const Mesh& mesh{ m_SoftwareMeshes[meshIdx] };
+			const MeshFrame& meshFrame{ frame.meshes[meshIdx] };
+			if (!meshFrame.isVisible)
+				continue;
+
+			//Only the meshlets that passed culling, their triangles are unrolled & without degenerates
+			if (meshFrame.isUsingMeshlets)
+			{
+				for (const uint32_t meshletIdx : meshFrame.visibleMeshlets)
+				{
+					const Meshlet& meshlet{ mesh.meshlets[meshletIdx] };
+					const uint8_t* pTriangles{ mesh.meshletTriangles.data() + size_t(meshlet.triangleOffset) * 3 };
+					for (uint32_t triangleIdx{ 0 }; triangleIdx < meshlet.nrTriangles; ++triangleIdx)
+					{
+						binTriangle(meshFrame, meshlet.vertexOffset + pTriangles[triangleIdx * 3 + 0],
+							meshlet.vertexOffset + pTriangles[triangleIdx * 3 + 1], meshlet.vertexOffset + pTriangles[triangleIdx * 3 + 2]);
+					}
+				}
+				continue;
+			}
+
 			int incr = { 3 };
 			if (mesh.primitiveTopology == PrimitiveTopology::TriangleStrip)
 				incr = 1;
@@ -233,179 +566,366 @@ namespace dae {
 				if (idx % 2 != 0 && mesh.primitiveTopology == PrimitiveTopology::TriangleStrip)
 					std::swap(idxB, idxC);
 
-				//Frustum Culling
-				//Vertex 0 - Check if x & y are inside [-1, 1] and z inside [0, 1] => DirectX convention
-				if ((mesh.vertices_out[idxA].position.x < -1.f || mesh.vertices_out[idxA].position.x > 1.f) &&
-					(mesh.vertices_out[idxB].position.x < -1.f || mesh.vertices_out[idxB].position.x > 1.f) &&
-					(mesh.vertices_out[idxC].position.x < -1.f || mesh.vertices_out[idxC].position.x > 1.f))
-					continue;
-				if ((mesh.vertices_out[idxA].position.y < -1.f || mesh.vertices_out[idxA].position.y > 1.f) &&
-					(mesh.vertices_out[idxB].position.y < -1.f || mesh.vertices_out[idxB].position.y > 1.f) &&
-					(mesh.vertices_out[idxC].position.y < -1.f || mesh.vertices_out[idxC].position.y > 1.f))
-					continue;
-				if (mesh.vertices_out[idxA].position.z < 0.f || mesh.vertices_out[idxA].position.z > 1.f ||
-					mesh.vertices_out[idxB].position.z < 0.f || mesh.vertices_out[idxB].position.z > 1.f ||
-					mesh.vertices_out[idxC].position.z < 0.f || mesh.vertices_out[idxC].position.z > 1.f)
-					continue;
+				binTriangle(meshFrame, idxA, idxB, idxC);
+			}
+		}
 
-				// Move from NDC to Raster Space - not a part of the projection stage
-				mesh.vertices_out[idxA].position.x = ((mesh.vertices_out[idxA].position.x + 1) / 2.f) * float(m_Width);
-				mesh.vertices_out[idxA].position.y = ((1 - mesh.vertices_out[idxA].position.y) / 2.f) * float(m_Height);
-				mesh.vertices_out[idxB].position.x = ((mesh.vertices_out[idxB].position.x + 1) / 2.f) * float(m_Width);
-				mesh.vertices_out[idxB].position.y = ((1 - mesh.vertices_out[idxB].position.y) / 2.f) * float(m_Height);
-				mesh.vertices_out[idxC].position.x = ((mesh.vertices_out[idxC].position.x + 1) / 2.f) * float(m_Width);
-				mesh.vertices_out[idxC].position.y = ((1 - mesh.vertices_out[idxC].position.y) / 2.f) * float(m_Height);
+		//Clusters of consecutive triangles by quantized centroid depth, near first - the radix sort is stable,
+		//so clusters at the same depth keep their order and the draw order only depends on the scene
+		const size_t nrClusters{ (nrTriangles + m_SortClusterSize - 1) / m_SortClusterSize };
+		uint32_t* pClusterOrder{ frameArena.Allocate<uint32_t>(nrClusters) };
+		for (size_t clusterIdx{ 0 }; clusterIdx < nrClusters; ++clusterIdx)
+			pClusterOrder[clusterIdx] = uint32_t(clusterIdx);
 
-				//Get the bounding box TOP LEFT point
-				Vector2 boundingBoxMin{};
-				boundingBoxMin.x = std::min(mesh.vertices_out[idxA].position.x, std::min(mesh.vertices_out[idxB].position.x, mesh.vertices_out[idxC].position.x));
-				boundingBoxMin.y = std::min(mesh.vertices_out[idxA].position.y, std::min(mesh.vertices_out[idxB].position.y, mesh.vertices_out[idxC].position.y));
-				//Clamp is needed otherwise the image will repeat itself
-				boundingBoxMin.x = Clamp(boundingBoxMin.x, 0.f, float(m_Width));
-				boundingBoxMin.y = Clamp(boundingBoxMin.y, 0.f, float(m_Height));
-				//Get the bounding box LOWER RIGHT point
-				Vector2 boundingBoxMax{};
-				boundingBoxMax.x = std::max(mesh.vertices_out[idxA].position.x, std::max(mesh.vertices_out[idxB].position.x, mesh.vertices_out[idxC].position.x));
-				boundingBoxMax.y = std::max(mesh.vertices_out[idxA].position.y, std::max(mesh.vertices_out[idxB].position.y, mesh.vertices_out[idxC].position.y));
-				//Clamp is needed otherwise the image will repeat itself
-				boundingBoxMax.x = Clamp(boundingBoxMax.x, 0.f, float(m_Width));
-				boundingBoxMax.y = Clamp(boundingBoxMax.y, 0.f, float(m_Height));
+		if (frame.isTriangleSortEnabled && nrClusters > 1)
+		{
+			uint32_t* pClusterKeys{ frameArena.Allocate<uint32_t>(nrClusters) };
+			const float depthRange{ maxFrameDepth - minFrameDepth };
+			const float depthToKey{ depthRange > 0.f ? float(m_SortKeyMax) / depthRange : 0.f };
+			for (size_t clusterIdx{ 0 }; clusterIdx < nrClusters; ++clusterIdx)
+			{
+				const size_t triangleBegin{ clusterIdx * m_SortClusterSize };
+				const size_t triangleEnd{ std::min(triangleBegin + m_SortClusterSize, nrTriangles) };
+				float depthSum{ 0.f };
+				for (size_t triangleIdx{ triangleBegin }; triangleIdx < triangleEnd; ++triangleIdx)
+					depthSum += pTriangles[triangleIdx].minDepth + pTriangles[triangleIdx].maxDepth;
+
+				const float centroidDepth{ depthSum / float(2 * (triangleEnd - triangleBegin)) };
+				pClusterKeys[clusterIdx] = std::min(uint32_t((centroidDepth - minFrameDepth) * depthToKey), m_SortKeyMax);
+			}
+			ParallelRadixSort(pClusterKeys, pClusterOrder, nrClusters, m_SortKeyBits, frameArena);
+		}
 
-				//RENDER LOGIC
-				for (int px = boundingBoxMin.x; px < boundingBoxMax.x; ++px)
-				{
-					for (int py = boundingBoxMin.y; py < boundingBoxMax.y; ++py)
-					{
-						if (m_BoundingBoxVisualizationEnabled)
-						{
-							ColorRGB finalColor{ 1.f,1.f,1.f };
+		//Bin of tile i is [pBinOffsets[i], pBinOffsets[i + 1]) of pBinnedTriangles, in draw order
+		for (size_t tileIdx{ 0 }; tileIdx < nrTiles; ++tileIdx)
+			pBinOffsets[tileIdx + 1] += pBinOffsets[tileIdx];
 
-							m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-								static_cast<uint8_t>(finalColor.r * 255),
-								static_cast<uint8_t>(finalColor.g * 255),
-								static_cast<uint8_t>(finalColor.b * 255));
+		uint32_t* pBinnedTriangles{ frameArena.Allocate<uint32_t>(pBinOffsets[nrTiles]) };
+		uint32_t* pBinEnds{ frameArena.Allocate<uint32_t>(nrTiles) };
+		std::copy(pBinOffsets, pBinOffsets + nrTiles, pBinEnds);
 
-							continue;
-						}
+		//Estimated cost per tile: the bounding box pixels of its triangles inside the tile plus a fixed cost per triangle
+		float* pTileCosts{ frameArena.Allocate<float>(nrTiles) };
+		std::fill(pTileCosts, pTileCosts + nrTiles, 0.f);
+		float totalCost{ 0.f };
+		for (size_t orderIdx{ 0 }; orderIdx < nrClusters; ++orderIdx)
+		{
+			const size_t triangleBegin{ size_t(pClusterOrder[orderIdx]) * m_SortClusterSize };
+			const size_t triangleEnd{ std::min(triangleBegin + m_SortClusterSize, nrTriangles) };
+			for (size_t triangleIdx{ triangleBegin }; triangleIdx < triangleEnd; ++triangleIdx)
+			{
+				const BinnedTriangle& triangle{ pTriangles[triangleIdx] };
+				ForEachTile(triangle, tileSize, nrTilesX, [&](size_t tileIdx)
+					{
+						pBinnedTriangles[pBinEnds[tileIdx]++] = uint32_t(triangleIdx);
+
+						const int tilePxBegin{ int(tileIdx % nrTilesX) * tileSize };
+						const int tilePyBegin{ int(tileIdx / nrTilesX) * tileSize };
+						const int width{ std::min(triangle.pxEnd, tilePxBegin + tileSize) - std::max(triangle.pxBegin, tilePxBegin) };
+						const int height{ std::min(triangle.pyEnd, tilePyBegin + tileSize) - std::max(triangle.pyBegin, tilePyBegin) };
+						const float cost{ float(width * height) + m_TileTriangleCost };
+						pTileCosts[tileIdx] += cost;
+						totalCost += cost;
+					});
+			}
+		}
 
-						//Make a point of the center of the current pixel
-						const Vector2 point = { float(px) + 0.5f, float(py) + 0.5f };
+		//SCHEDULING
+		//Most expensive work first, so the cheap tiles fill the gaps at the end instead of one hot tile finishing last
+		//A tile that costs more than a fraction of the share of one thread is split in bands of rows
+		JobSystem& jobSystem{ JobSystem::Get() };
+		const int nrThreads{ jobSystem.GetNrThreads() };
+		const float hotTileCost{ totalCost / float(nrThreads * m_HotTilesPerThread) };
 
-						//Make vectors from the point on the triangle to the point that you want to check
-						const Vector2 AP = point - mesh.vertices_out[idxA].position.GetXY();
-						const Vector2 BP = point - mesh.vertices_out[idxB].position.GetXY();
-						const Vector2 CP = point - mesh.vertices_out[idxC].position.GetXY();
+		TileWork* pTileWork{ frameArena.Allocate<TileWork>(nrTiles * m_MaxTileBands) };
+		size_t nrTileWork{ 0 };
+		for (size_t tileIdx{ 0 }; tileIdx < nrTiles; ++tileIdx)
+		{
+			//Tiles without triangles are filled in Resolve
+			if (pBinOffsets[tileIdx] == pBinOffsets[tileIdx + 1])
+				continue;
 
-						//Make vectors [AB], [BC] & [CB]
-						const Vector2 AB = mesh.vertices_out[idxA].position.GetXY() - mesh.vertices_out[idxB].position.GetXY();
-						const Vector2 BC = mesh.vertices_out[idxB].position.GetXY() - mesh.vertices_out[idxC].position.GetXY();
-						const Vector2 CA = mesh.vertices_out[idxC].position.GetXY() - mesh.vertices_out[idxA].position.GetXY();
+			const int tilePyBegin{ int(tileIdx / nrTilesX) * tileSize };
+			const int tilePyEnd{ std::min(tilePyBegin + tileSize, m_Height) };
+			const int nrBlockRows{ (tilePyEnd - tilePyBegin + FrameBuffer::BlockSize - 1) / FrameBuffer::BlockSize };
+			const int nrBands{ frame.isDeterministic ? 1 : std::clamp(int(ceilf(pTileCosts[tileIdx] / hotTileCost)), 1, std::min(m_MaxTileBands, nrBlockRows)) };
 
-						//Calculate the cross product from each pointOfTriangle to the point
-						const float signedParallelogramAB = Vector2::Cross(AP, AB);
-						const float signedParallelogramBC = Vector2::Cross(BP, BC);
-						const float signedParallelogramCA = Vector2::Cross(CP, CA);
+			//Bands of one tile run on different threads, so a split tile is cleared here once instead of by its first band
+			if (nrBands > 1)
+			{
+				const int tilePxBegin{ int(tileIdx % nrTilesX) * tileSize };
+				m_pFrameBuffer->TouchRect(tilePxBegin, tilePyBegin, std::min(tilePxBegin + tileSize, m_Width), tilePyEnd);
+			}
+
+			//Bands are whole block rows, two threads never write the same block
+			const int rowsPerBand{ (nrBlockRows + nrBands - 1) / nrBands * FrameBuffer::BlockSize };
+			for (int bandPyBegin{ tilePyBegin }; bandPyBegin < tilePyEnd; bandPyBegin += rowsPerBand)
+			{
+				TileWork& work{ pTileWork[nrTileWork++] };
+				work.tileIdx = uint32_t(tileIdx);
+				work.pyBegin = bandPyBegin;
+				work.pyEnd = std::min(bandPyBegin + rowsPerBand, tilePyEnd);
+				work.cost = pTileCosts[tileIdx] * float(work.pyEnd - work.pyBegin) / float(tilePyEnd - tilePyBegin);
+			}
+		}
+		if (!frame.isDeterministic)
+			std::sort(pTileWork, pTileWork + nrTileWork, [](const TileWork& a, const TileWork& b) { return a.cost > b.cost; });
+
+		//RENDER LOGIC
+		//Tiles own their pixels, so they are rasterized in parallel without locks
+		//Per pixel the triangles still arrive in draw order & on equal depth the later one wins, the image doesn't depend on the thread count
+		//Every thread takes the next most expensive piece of work until none are left,
+		//deterministic: whole tiles in index order, thread i owns tiles i, i + nrThreads, ...
+		std::atomic<size_t> nextTileWork{ 0 };
+		jobSystem.ParallelFor(size_t(nrThreads), 1, [&](size_t threadIdx, size_t)
+			{
+				//A row of a block produces at most BlockSize fragments, a whole block at most BlockSize * BlockSize
+				Fragment pFragments[FrameBuffer::BlockSize * FrameBuffer::BlockSize];
+				Vertex_Out pShaderInputs[FrameBuffer::BlockSize];
 
-						//Get the total area of the triangle - '-CA' to have [AB] X [AC]
-						const float totalAreaTriangle = Vector2::Cross(AB, -CA);
+				//Interpolation & shading of the fragments of one row, rowOffset is the storage index of pixel rowPxBegin
+				const auto shadeRow = [&](const BinnedTriangle& triangle, const Fragment* pRowFragments, int nrFragments, int py, size_t rowOffset, int rowPxBegin)
+					{
+						if (!frame.isDepthBufferEnabled)
+							shadingEngine.InterpolateFragments(kernels, triangle.varyings, pRowFragments, nrFragments, py, pShaderInputs);
 
-						//If the cross products each have the same sign, then 'point' is in the triangle
-						if (signedParallelogramAB > 0 && signedParallelogramBC > 0 && signedParallelogramCA > 0)
+						for (int i{ 0 }; i < nrFragments; ++i)
 						{
-							//Value gives back how much of the triangle's area covers the total triangle
-							const float weightA = signedParallelogramBC / totalAreaTriangle;
-							const float weightB = signedParallelogramCA / totalAreaTriangle;
-							const float weightC = signedParallelogramAB / totalAreaTriangle;
-							//Total weight should be 1 - otherwise somethings wrong
-
-							//DEPTH TEST
-							//ZbufferValue - non-linear
-							const float interpolatedDepthZ = { 1 / (
-								(1 / mesh.vertices_out[idxA].position.z * weightA) +
-								(1 / mesh.vertices_out[idxB].position.z * weightB) +
-								(1 / mesh.vertices_out[idxC].position.z * weightC)) };
-
-							if (interpolatedDepthZ > m_pDepthBufferPixels[px + (py * m_Width)])
-								continue;
-
-							m_pDepthBufferPixels[px + (py * m_Width)] = interpolatedDepthZ;
-
-							//RASTERIZATION STAGE
-							//Transform all necessary attributes accordingly, interpolate and store them in the vertex output
-
-							//WbufferValue - linear
-							//When When we want to interpolate vertex attributes with a correct depth (color, uv, normals,
-							//etc), we still use the View Space depth Vw
-							const float interpolatedDepthW = { 1 / (
-								(1 / mesh.vertices_out[idxA].position.w * weightA) +
-								(1 / mesh.vertices_out[idxB].position.w * weightB) +
-								(1 / mesh.vertices_out[idxC].position.w * weightC)) };
-
-							//Divide each attribute by the original vertex depth and interpolate 
-							const Vector2 interpolatedUV = { (
-								mesh.vertices_out[idxA].uv / mesh.vertices_out[idxA].position.w * weightA +
-								mesh.vertices_out[idxB].uv / mesh.vertices_out[idxB].position.w * weightB +
-								mesh.vertices_out[idxC].uv / mesh.vertices_out[idxC].position.w * weightC) * interpolatedDepthW };
-							const ColorRGB interpolatedColor = { (
-								mesh.vertices_out[idxA].color / mesh.vertices_out[idxA].position.w * weightA +
-								mesh.vertices_out[idxB].color / mesh.vertices_out[idxB].position.w * weightB +
-								mesh.vertices_out[idxC].color / mesh.vertices_out[idxC].position.w * weightC) * interpolatedDepthW };
-							const Vector3 interpolatedNormal = { (
-								mesh.vertices_out[idxA].normal / mesh.vertices_out[idxA].position.w * weightA +
-								mesh.vertices_out[idxB].normal / mesh.vertices_out[idxB].position.w * weightB +
-								mesh.vertices_out[idxC].normal / mesh.vertices_out[idxC].position.w * weightC) * interpolatedDepthW };
-							const Vector3 interpolatedTangent = { (
-								mesh.vertices_out[idxA].tangent / mesh.vertices_out[idxA].position.w * weightA +
-								mesh.vertices_out[idxB].tangent / mesh.vertices_out[idxB].position.w * weightB +
-								mesh.vertices_out[idxC].tangent / mesh.vertices_out[idxC].position.w * weightC) * interpolatedDepthW };
-							const Vector3 interpolatedViewDir = { (
-								mesh.vertices_out[idxA].viewDirection / mesh.vertices_out[idxA].position.w * weightA +
-								mesh.vertices_out[idxB].viewDirection / mesh.vertices_out[idxB].position.w * weightB +
-								mesh.vertices_out[idxC].viewDirection / mesh.vertices_out[idxC].position.w * weightC) * interpolatedDepthW };
-
-							Vertex_Out vertOut{};
-							vertOut.position.x = px;
-							vertOut.position.y = py;
-							vertOut.position.z = interpolatedDepthZ;
-							vertOut.position.w = interpolatedDepthW;
-							vertOut.uv = interpolatedUV;
-							vertOut.color = interpolatedColor;
-							vertOut.normal = interpolatedNormal.Normalized();
-							vertOut.tangent = interpolatedTangent.Normalized();
-							vertOut.viewDirection = interpolatedViewDir.Normalized();
+							const Fragment& fragment{ pRowFragments[i] };
 
 							// Shade your model with Lambert Diffuse
 							ColorRGB finalColor{};
-							if (m_DepthBufferEnabled)
+							if (frame.isDepthBufferEnabled)
 							{
 								const float min{ 0.995f };
 								const float max{ 1.0f };
-								float depthColor = (Clamp(interpolatedDepthZ, min, max) - min) * (1.0f / (max - min));
+								float depthColor = (Clamp(fragment.depthZ, min, max) - min) * (1.0f / (max - min));
 								finalColor = { depthColor, depthColor, depthColor };
 							}
 							else
-								finalColor = PixelShading(vertOut);
+								finalColor = PixelShading(pShaderInputs[i], frame);
+
+							//Update Color in Buffer, MaxToOne is part of the packing
+							pBackBufferPixels[rowOffset + (fragment.px - rowPxBegin)] = FrameBuffer::PackColor(finalColor);
+						}
+					};
+
+				const auto getNextTileWork = [&](size_t workIdx) { return frame.isDeterministic ? workIdx + size_t(nrThreads) : nextTileWork++; };
+				for (size_t workIdx{ frame.isDeterministic ? threadIdx : nextTileWork++ }; workIdx < nrTileWork; workIdx = getNextTileWork(workIdx))
+				{
+					const TileWork& work{ pTileWork[workIdx] };
+					const size_t tileIdx{ work.tileIdx };
 
-							//Update Color in Buffer
-							finalColor.MaxToOne();
+					const int tilePxBegin{ int(tileIdx % nrTilesX) * tileSize };
+					const int tilePyBegin{ work.pyBegin };
+					const int tilePxEnd{ std::min(tilePxBegin + tileSize, m_Width) };
+					const int tilePyEnd{ work.pyEnd };
+					m_pFrameBuffer->TouchRect(tilePxBegin, tilePyBegin, tilePxEnd, tilePyEnd);
+
+					for (uint32_t binIdx{ pBinOffsets[tileIdx] }; binIdx < pBinOffsets[tileIdx + 1]; ++binIdx)
+					{
+						const BinnedTriangle& triangle{ pTriangles[pBinnedTriangles[binIdx]] };
+
+						//Part of the bounding box inside this tile
+						const int pxBegin{ std::max(triangle.pxBegin, tilePxBegin) };
+						const int pxEnd{ std::min(triangle.pxEnd, tilePxEnd) };
+						const int pyBegin{ std::max(triangle.pyBegin, tilePyBegin) };
+						const int pyEnd{ std::min(triangle.pyEnd, tilePyEnd) };
+						if (pyBegin >= pyEnd)
+							continue;
+
+						if (frame.isBoundingBoxVisualizationEnabled)
+						{
+							const uint32_t white{ FrameBuffer::PackColor({ 1.f, 1.f, 1.f }) };
+							for (int py = pyBegin; py < pyEnd; ++py)
+							{
+								for (int px = pxBegin; px < pxEnd; ++px)
+									pBackBufferPixels[m_pFrameBuffer->GetOffset(px, py)] = white;
+							}
+							continue;
+						}
+
+						//Tiny: every pixel center on its own, no block traversal
+						if (triangle.triangleClass == TriangleClass::Tiny && rasterEngine.isUsingFastPaths)
+						{
+							for (int py{ pyBegin }; py < pyEnd; ++py)
+							{
+								for (int px{ pxBegin }; px < pxEnd; ++px)
+								{
+									if (frame.isDepthCompressed)
+									{
+										const FrameBuffer::DepthBlock& depthBlock{ m_pFrameBuffer->GetDepthBlock(px, py) };
+										if (depthBlock.state != FrameBuffer::DepthBlockState::Cleared && triangle.minDepth > depthBlock.maxDepth)
+											continue;
+										m_pFrameBuffer->DecompressDepthBlock(px, py, kernels);
+									}
+
+									const size_t offset{ m_pFrameBuffer->GetOffset(px, py) };
+									if (kernels.RasterizeRow(triangle.setup, py, px, px + 1, pDepthBufferPixels + offset, pFragments) == 0)
+										continue;
+
+									shadeRow(triangle, pFragments, 1, py, offset, px);
+									if (frame.isDepthCompressed)
+										m_pFrameBuffer->UpdateDepthBounds(px, py);
+								}
+							}
+							continue;
+						}
 
-							m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-								static_cast<uint8_t>(finalColor.r * 255),
-								static_cast<uint8_t>(finalColor.g * 255),
-								static_cast<uint8_t>(finalColor.b * 255));
+						//Block by block in storage order, row by row inside a block: the pixels of a block row are contiguous
+						//Coverage & depth test, interpolation of the passed pixels, then shading
+						const int blockPxFirst{ pxBegin - pxBegin % FrameBuffer::BlockSize };
+						const int blockPyFirst{ pyBegin - pyBegin % FrameBuffer::BlockSize };
+						for (int blockPy{ blockPyFirst }; blockPy < pyEnd; blockPy += FrameBuffer::BlockSize)
+						{
+							for (int blockPx{ blockPxFirst }; blockPx < pxEnd; blockPx += FrameBuffer::BlockSize)
+							{
+								const int rowPxBegin{ std::max(pxBegin, blockPx) };
+								const int rowPxEnd{ std::min(pxEnd, blockPx + FrameBuffer::BlockSize) };
+								const int rowPyBegin{ std::max(pyBegin, blockPy) };
+								const int rowPyEnd{ std::min(pyEnd, blockPy + FrameBuffer::BlockSize) };
+
+								//Large: the corners of the block decide if its pixels need the coverage test at all
+								BlockCoverage coverage{ BlockCoverage::Partial };
+								if (triangle.triangleClass == TriangleClass::Large && rasterEngine.isUsingFastPaths)
+								{
+									coverage = kernels.ClassifyBlock(triangle.setup, rowPxBegin, rowPyBegin, rowPxEnd, rowPyEnd);
+									if (coverage == BlockCoverage::Outside)
+										continue;
+								}
+								//Partially covered rows go through the selected engine
+								const auto rasterizeRow = [&](int py, int rowPxBegin, int rowPxEnd, float* pDepth, Fragment* pRowFragments)
+									{
+										if (coverage == BlockCoverage::Inside)
+											return kernels.RasterizeInsideRow(triangle.setup, py, rowPxBegin, rowPxEnd, pDepth, pRowFragments);
+										return rasterEngine.RasterizeRow(kernels, triangle.setup, py, rowPxBegin, rowPxEnd, pDepth, pRowFragments);
+									};
+
+								//Compressed depth: the metadata answers the depth test of the whole block when it can
+								if (frame.isDepthCompressed)
+								{
+									FrameBuffer::DepthBlock& depthBlock{ m_pFrameBuffer->GetDepthBlock(blockPx, blockPy) };
+
+									//Every pixel of the triangle is behind every pixel of the block
+									if (depthBlock.state != FrameBuffer::DepthBlockState::Cleared && triangle.minDepth > depthBlock.maxDepth)
+										continue;
+
+									//Every pixel of the triangle is in front of every pixel of the block, if it covers the whole block
+									//the block becomes its plane and the per pixel depth isn't touched
+									const bool isWholeBlock{ rowPxEnd - rowPxBegin == FrameBuffer::BlockSize && rowPyEnd - rowPyBegin == FrameBuffer::BlockSize };
+									const bool isCleared{ depthBlock.state == FrameBuffer::DepthBlockState::Cleared };
+									if (isWholeBlock && (isCleared || triangle.maxDepth < depthBlock.minDepth))
+									{
+										//Against a cleared block every covered pixel passes, same result as the per pixel test
+										float pBlockDepth[FrameBuffer::BlockSize * FrameBuffer::BlockSize];
+										std::fill_n(pBlockDepth, FrameBuffer::BlockSize * FrameBuffer::BlockSize, FLT_MAX);
+
+										int pRowFragments[FrameBuffer::BlockSize];
+										int nrBlockFragments{ 0 };
+										for (int row{ 0 }; row < FrameBuffer::BlockSize; ++row)
+										{
+											pRowFragments[row] = rasterizeRow(blockPy + row, blockPx, blockPx + FrameBuffer::BlockSize,
+												pBlockDepth + row * FrameBuffer::BlockSize, pFragments + nrBlockFragments);
+											nrBlockFragments += pRowFragments[row];
+										}
+										if (nrBlockFragments == 0)
+											continue;
+
+										const bool isCovered{ nrBlockFragments == FrameBuffer::BlockSize * FrameBuffer::BlockSize };
+										if (isCovered || isCleared)
+										{
+											if (isCovered)
+												depthBlock = { triangle.minDepth, triangle.maxDepth, &triangle.setup, FrameBuffer::DepthBlockState::Plane };
+											else
+											{
+												//Partially covered cleared block: the depth just rasterized is its per pixel depth
+												std::copy_n(pBlockDepth, FrameBuffer::BlockSize * FrameBuffer::BlockSize, pDepthBufferPixels + m_pFrameBuffer->GetOffset(blockPx, blockPy));
+												depthBlock.state = FrameBuffer::DepthBlockState::Raw;
+												m_pFrameBuffer->UpdateDepthBounds(blockPx, blockPy);
+											}
+
+											const Fragment* pRowFragment{ pFragments };
+											for (int row{ 0 }; row < FrameBuffer::BlockSize; ++row)
+											{
+												if (pRowFragments[row] > 0)
+													shadeRow(triangle, pRowFragment, pRowFragments[row], blockPy + row, m_pFrameBuffer->GetOffset(blockPx, blockPy + row), blockPx);
+												pRowFragment += pRowFragments[row];
+											}
+											continue;
+										}
+									}
+
+									//Partially covered: the test needs the per pixel depth
+									m_pFrameBuffer->DecompressDepthBlock(blockPx, blockPy, kernels);
+								}
+
+								bool isDepthWritten{ false };
+								for (int py{ rowPyBegin }; py < rowPyEnd; ++py)
+								{
+									const size_t rowOffset{ m_pFrameBuffer->GetOffset(rowPxBegin, py) };
+									const int nrFragments{ rasterizeRow(py, rowPxBegin, rowPxEnd, pDepthBufferPixels + rowOffset, pFragments) };
+									if (nrFragments == 0)
+										continue;
+
+									shadeRow(triangle, pFragments, nrFragments, py, rowOffset, rowPxBegin);
+									isDepthWritten = true;
+								}
+
+								if (frame.isDepthCompressed && isDepthWritten)
+									m_pFrameBuffer->UpdateDepthBounds(blockPx, blockPy);
+							}
 						}
 					}
 				}
-			}
-		}
+			});
 
 
 		//@END
-		//Update SDL Surface
-		SDL_UnlockSurface(m_pBackBuffer);
-		SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
-		SDL_UpdateWindowSurface(m_pWindow);
+		//Hand the frame to the present thread and continue with the next one in a free buffer
+		//Frames that aren't presented stay in the frame buffer, they aren't timed either
+		if (isPresented)
+		{
+			m_pFrameBuffer->Resolve();
 
+			m_SoftwareRasterCounts += SDL_GetPerformanceCounter() - rasterStart;
+			++m_NrTimedSoftwareFrames;
+			m_pSoftwarePresenter->Present();
+		}
+
+		//Release every temporary of this frame at once
+		frameArena.Reset();
+
+		//Steady state: neither the raster thread nor the workers allocate from the heap, arena blocks aren't counted
+		assert(AllocationCounter::GetCount() == nrAllocationsAtStart && "ERROR: heap allocation in the software frame loop, allocate from the FrameArena instead!");
+#if defined(_DEBUG)
+		if (frameArena.GetNrGrowths() != nrArenaGrowthsAtStart)
+			std::cout << PURPLE << "**(SOFTWARE) Raster stage FrameArena grew to " << frameArena.GetCapacity() / 1024 << " KB\n" << RESET;
+#endif
+	}
+
+	void Renderer::RasterThreadLoop()
+	{
+		std::unique_lock lock{ m_SoftwareFrameMutex };
+		while (true)
+		{
+			m_SoftwareFrameChanged.wait(lock, [&]() { return m_IsStoppingRasterThread || m_NrSubmittedSoftwareFrames > m_NrRasterizedSoftwareFrames; });
+			//Frames that were submitted are still rasterized, so the presenter gets every one of them
+			if (m_NrSubmittedSoftwareFrames == m_NrRasterizedSoftwareFrames)
+				return;
+
+			const SoftwareFrame& frame{ m_SoftwareFrames[m_NrRasterizedSoftwareFrames % m_NrSoftwareFrames] };
+			lock.unlock();
+			RasterizeSoftwareFrame(frame);
+			lock.lock();
+
+			++m_NrRasterizedSoftwareFrames;
+			m_SoftwareFrameChanged.notify_all();
+		}
+	}
+	void Renderer::WaitForSoftwareFrames()
+	{
+		std::unique_lock lock{ m_SoftwareFrameMutex };
+		m_SoftwareFrameChanged.wait(lock, [&]() { return m_NrRasterizedSoftwareFrames == m_NrSubmittedSoftwareFrames; });
 	}
 
 	// UPDATE
@@ -415,11 +935,16 @@ namespace dae {
 		{
 			mesh->RotateY(m_CurrentAngle);
 			mesh->Translation(0, 0, 50);
-			mesh->Update(m_Camera.GetWorldViewProjection(), m_Camera.GetInverseViewMatrix());
+			mesh->Update(m_Camera.GetWorldViewProjection(), m_Camera.GetInverseViewMatrix(), m_Camera.version);
 		}
 	}
 	void Renderer::UpdateSoftwareRasterizer(const Timer* pTimer)
 	{
+		//Only rebuilt when the rotation changed since the last update
+		if (m_CurrentAngle == m_SoftwareMeshAngle)
+			return;
+
+		m_SoftwareMeshAngle = m_CurrentAngle;
 		for (auto& mesh : m_SoftwareMeshes)
 		{
 			mesh.worldMatrix = Matrix::CreateRotationY(m_CurrentAngle) * Matrix::CreateTranslation(0.f, 0.f, 50.f);
@@ -453,7 +978,7 @@ namespace dae {
 		swapChainDesc.BufferDesc.Height = m_Height;
 		swapChainDesc.BufferDesc.RefreshRate.Numerator = 1; 
 		swapChainDesc.BufferDesc.RefreshRate.Denominator = 60;
-		swapChainDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		swapChainDesc.BufferDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;	// Layout of the software rasterizer pixels, uploaded as they are
 		swapChainDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED; 
 		swapChainDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
 		swapChainDesc.SampleDesc.Count = 1;
@@ -533,36 +1058,27 @@ namespace dae {
 	}
 
 	// From software rasterizer
-	ColorRGB Renderer::PixelShading(const Vertex_Out& v) const
+	ColorRGB Renderer::PixelShading(const Vertex_Out& v, const SoftwareFrame& frame) const
 	{
 		const Vector3 lightDirection = { .577f, -.577f, .577f };
 		// Diffuse Reflection Coefficient
 		const float lightIntensity = { 7.f };
-		const float shininess = { 25.f };
 		const ColorRGB ambient = { .025f, .025f, .025f };
 
-		const ColorRGB diffuse{ m_pDiffuseTexture->Sample(v.uv) };
-		const ColorRGB lambertDiffuseColor{ (lightIntensity * diffuse) / PI };
-
-		//-------------------------
-		// NORMAL MAPS
-		// Calculate tangentSpaceAxis
-		const Vector3 binormal = { Vector3::Cross(v.normal, v.tangent) };
-		const Matrix tangentSpaceAxis = Matrix{ v.tangent, binormal, v.normal, Vector3::Zero };
-
-		// When sampling our normal is in [0, 255], but normalized vectors have [-1, 1]
-		ColorRGB sampledNormal = { m_pNormalTexture->Sample(v.uv) };
-		// no need to divide by 255 - [0, 255] -> [0, 1] - is already done in the sample function
-		const Vector3 sampledNormalRemap = { 2.f * sampledNormal.r - 1.f, 2.f * sampledNormal.g - 1.f, 2.f * sampledNormal.b - 1.f }; // [0, 1] -> [-1, 1]
-
-		// Calculate sampled normal to tanget space
-		const Vector3 sampleNrmlTangentSpace{ tangentSpaceAxis.TransformVector(sampledNormalRemap.Normalized()).Normalized() };
-
 		//-------------------------
 		// NORMAL MAP ENABLED
 		Vector3 selectedNormal{};
-		if (m_NormalMapEnabled)
-			selectedNormal = sampleNrmlTangentSpace;
+		if (frame.isNormalMapEnabled)
+		{
+			//-------------------------
+			// NORMAL MAPS
+			// The normal map is already remapped to [-1, 1] when it was loaded
+			const Vector3 binormal = { Vector3::Cross(v.normal, v.tangent) };
+			const Vector3 sampledNormal = { m_pNormalMap->Sample(v.uv) };
+
+			// Calculate sampled normal to tangent space, only one normalize is needed since the TBN is linear
+			selectedNormal = NormalMap::TangentToWorld(sampledNormal, v.tangent, binormal, v.normal).Normalized();
+		}
 		else
 			selectedNormal = v.normal;
 
@@ -575,72 +1091,258 @@ namespace dae {
 		if (observedArea < 0)
 			return ColorRGB{ 0, 0, 0 };
 
+		ColorRGB finalColor{ observedArea, observedArea, observedArea };
+		if (frame.lightingMode == LightingMode::ObservedArea)
+			return finalColor;
+
+		//-------------------------
+		// LAMBERT
+		// Only sampled by the modes that use it, UV is not interpolated otherwise
+		ColorRGB lambertDiffuseColor{};
+		if (frame.lightingMode != LightingMode::Specular)
+		{
+			const ColorRGB diffuse{ m_pDiffuseTexture->Sample(v.uv) };
+			lambertDiffuseColor = (lightIntensity * diffuse) / PI;
+		}
+
+		if (frame.lightingMode == LightingMode::Diffuse)
+			return finalColor *= lambertDiffuseColor;
+
 		//-------------------------
 		// PHONG
 		// Calculate the phong
 		const Vector3 reflect = { lightDirection - 2.f * Vector3::Dot(selectedNormal, lightDirection) * selectedNormal };
 		const float cosAlpha = { std::max(0.f, Vector3::Dot(reflect, v.viewDirection)) };
 		// r, g & b are the same so you can use either one
-		const ColorRGB specReflectance = { m_pSpecularTexture->Sample(v.uv) * powf(cosAlpha, m_pGlossTexture->Sample(v.uv).r * shininess) };
+		// Gloss is 8-bit, the lookup table replaces powf(cosAlpha, gloss * shininess)
+		const ColorRGB specReflectance = { m_pSpecularTexture->Sample(v.uv) * m_SpecularLUT.Evaluate(cosAlpha, m_pGlossTexture->Sample(v.uv).r) };
 
 		//-------------------------
 		// RETURN
-		ColorRGB finalColor{ observedArea, observedArea, observedArea };
+		if (frame.lightingMode == LightingMode::Specular)
+			return finalColor = specReflectance;
+
+		return finalColor *= lambertDiffuseColor + specReflectance + ambient;
+	}
+	void Renderer::VertexTransformationFunctionW3(const std::vector<Mesh>& meshes, SoftwareFrame& frame) const
+	{
+		const bool isUVLive{ HasVarying(frame.liveVaryings, Varying::UV) };
+		const bool isNormalLive{ HasVarying(frame.liveVaryings, Varying::Normal) };
+		const bool isTangentLive{ HasVarying(frame.liveVaryings, Varying::Tangent) };
+		const bool isViewDirectionLive{ HasVarying(frame.liveVaryings, Varying::ViewDirection) };
+
+		const SoftwareKernels& kernels{ GetSoftwareKernels() };
+		for (size_t meshIdx{ 0 }; meshIdx < meshes.size(); ++meshIdx)
+		{
+			const Mesh& mesh{ meshes[meshIdx] };
+			MeshFrame& meshFrame{ frame.meshes[meshIdx] };
+
+			meshFrame.worldMatrix = mesh.worldMatrix;
+
+			//Whole mesh culling before any vertex is transformed, the triangles of a visible mesh are culled in the raster stage
+			meshFrame.isVisible = frame.frustum.IsVisible(mesh.bounds, meshFrame.worldMatrix);
+			if (!meshFrame.isVisible)
+			{
+				meshFrame.positions_out = {};
+				meshFrame.uvs_out = {};
+				meshFrame.normals_out = {};
+				meshFrame.tangents_out = {};
+				meshFrame.viewDirections_out = {};
+				continue;
+			}
+
+			Matrix worldViewProjectionMatrix = { meshFrame.worldMatrix * frame.viewMatrix * frame.projectionMatrix };
+
+			// Meshlets have their own copy of the vertices, the streams are indexed like that copy
+			meshFrame.isUsingMeshlets = frame.isMeshletCullingEnabled && !mesh.meshlets.empty();
+			const std::vector<Vertex>& vertices{ meshFrame.isUsingMeshlets ? mesh.meshletVertices : mesh.vertices };
+
+			// The output streams are rebuilt every frame in the arena of the frame, dead attributes get no storage
+			FrameArena& frameArena{ frame.arena };
+			const size_t nrVertices{ vertices.size() };
+			meshFrame.positions_out = { frameArena.Allocate<Vector4>(nrVertices), nrVertices };
+			meshFrame.uvs_out = isUVLive ? std::span<Vector2>{ frameArena.Allocate<Vector2>(nrVertices), nrVertices } : std::span<Vector2>{};
+			meshFrame.normals_out = isNormalLive ? std::span<Vector3>{ frameArena.Allocate<Vector3>(nrVertices), nrVertices } : std::span<Vector3>{};
+			meshFrame.tangents_out = isTangentLive ? std::span<Vector3>{ frameArena.Allocate<Vector3>(nrVertices), nrVertices } : std::span<Vector3>{};
+			meshFrame.viewDirections_out = isViewDirectionLive ? std::span<Vector3>{ frameArena.Allocate<Vector3>(nrVertices), nrVertices } : std::span<Vector3>{};
+
+			const auto transformVertices = [&](size_t begin, size_t end)
+				{
+					//Dead streams stay nullptr
+					const auto offset = [begin](auto* pStream) { return pStream ? pStream + begin : nullptr; };
+
+					//Multiply every vertex with this matrix, which is the same for all vertices within one mesh!
+					//Perspective divide and NDC to raster space are done once per vertex here instead of once per triangle in the rasterizer
+					kernels.TransformPositions(reinterpret_cast<const float*>(&worldViewProjectionMatrix), vertices.data() + begin, end - begin,
+						float(m_Width), float(m_Height), meshFrame.positions_out.data() + begin);
+
+					// Conversion of the normal and tangent from viewspace to world space
+					// This is for the rotation - only for the attributes the shading mode reads
+					kernels.TransformAttributes(reinterpret_cast<const float*>(&meshFrame.worldMatrix), frame.cameraOrigin, vertices.data() + begin, end - begin,
+						offset(meshFrame.uvs_out.data()), offset(meshFrame.normals_out.data()), offset(meshFrame.tangents_out.data()), offset(meshFrame.viewDirections_out.data()));
+				};
+
+			if (!meshFrame.isUsingMeshlets)
+			{
+				meshFrame.visibleMeshlets = {};
+
+				//Vertices are independent, chunks of them are transformed in parallel
+				JobSystem::Get().ParallelFor(nrVertices, m_VertexGrainSize, transformVertices);
+				continue;
+			}
+
+			//Meshlets outside the frustum or facing away from the camera are dropped before any of their vertices is read,
+			//only the ranges of the others are written in the streams
+			uint32_t* pVisibleMeshlets{ frameArena.Allocate<uint32_t>(mesh.meshlets.size()) };
+			size_t nrVisibleMeshlets{ 0 };
+			for (uint32_t meshletIdx{ 0 }; meshletIdx < uint32_t(mesh.meshlets.size()); ++meshletIdx)
+			{
+				const Meshlet& meshlet{ mesh.meshlets[meshletIdx] };
+				if (frame.frustum.IsVisible(meshlet.bounds, meshFrame.worldMatrix) && !meshlet.IsBackFacing(meshFrame.worldMatrix, frame.cameraOrigin))
+					pVisibleMeshlets[nrVisibleMeshlets++] = meshletIdx;
+			}
+			meshFrame.visibleMeshlets = { pVisibleMeshlets, nrVisibleMeshlets };
+
+			JobSystem::Get().ParallelFor(nrVisibleMeshlets, m_MeshletGrainSize, [&](size_t begin, size_t end)
+				{
+					for (size_t visibleIdx{ begin }; visibleIdx < end; ++visibleIdx)
+					{
+						const Meshlet& meshlet{ mesh.meshlets[pVisibleMeshlets[visibleIdx]] };
+						transformVertices(meshlet.vertexOffset, meshlet.vertexOffset + meshlet.nrVertices);
+					}
+				});
+		}
+	}
+	Varying Renderer::GetLiveVaryings() const
+	{
+		// Visualizations only need the position
+		if (m_DepthBufferEnabled || m_BoundingBoxVisualizationEnabled)
+			return Varying::None;
+
+		// Every mode needs the normal for the observed area
+		Varying liveVaryings{ Varying::Normal };
+		if (m_NormalMapEnabled)
+			liveVaryings = liveVaryings | Varying::UV | Varying::Tangent;
+
 		switch (m_CurrentLightingMode)
 		{
 		case LightingMode::ObservedArea:
-			return finalColor;
+			break;
 		case LightingMode::Diffuse:
-			return finalColor *= lambertDiffuseColor;
+			liveVaryings = liveVaryings | Varying::UV;
+			break;
 		case LightingMode::Specular:
-			return finalColor = specReflectance;
 		case LightingMode::Combined:
-			return finalColor *= lambertDiffuseColor + specReflectance + ambient;
+			liveVaryings = liveVaryings | Varying::UV | Varying::ViewDirection;
+			break;
 		}
+		return liveVaryings;
 	}
-	void Renderer::VertexTransformationFunctionW3(std::vector<Mesh>& meshes) const
+
+	void Renderer::PrintStageTimings()
 	{
-		for (auto& mesh : meshes)
-		{
-			Matrix worldViewProjectionMatrix = { mesh.worldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix };
+		if (m_NrTimedSoftwareFrames == 0)
+			return;
+
+		//Present runs on the present thread, its frames can be dropped so it has its own frame count
+		const SoftwarePresenter::Statistics presentStatistics{ m_pSoftwarePresenter->TakeStatistics() };
+		const double countsToMs{ 1000.0 / double(SDL_GetPerformanceFrequency()) };
+		const double presentMs{ presentStatistics.nrPresentedFrames > 0 ?
+			presentStatistics.presentCounts * countsToMs / presentStatistics.nrPresentedFrames : 0.0 };
 
-			// If you want to change the vertices to for example rotate the mesh,
-			// you first have to get out the old values.
-			mesh.vertices_out.clear();
-			mesh.vertices_out.reserve(mesh.vertices.size());
+		//Vertex and raster run on different threads and overlap, a frame takes the longest stage, not their sum
+		std::cout << PURPLE << "**(SOFTWARE) Vertex " << m_SoftwareVertexCounts * countsToMs / m_NrTimedSoftwareFrames << " ms, Raster "
+			<< m_SoftwareRasterCounts * countsToMs / m_NrTimedSoftwareFrames << " ms, Present "
+			<< presentMs << " ms, Presented " << presentStatistics.nrPresentedFrames << ", Dropped " << presentStatistics.nrDroppedFrames << "\n" << RESET;
 
-			for (const Vertex& vertex : mesh.vertices)
+		m_SoftwareVertexCounts = 0;
+		m_SoftwareRasterCounts = 0;
+		m_NrTimedSoftwareFrames = 0;
+	}
+
+	void Renderer::AutoTune()
+	{
+		std::cout << PURPLE << "**(SOFTWARE) Auto-Tune, " << m_NrTuningFrames << " frames per setting\n";
+
+		//Nothing else renders during the sweep, the vehicle is measured where it is now
+		UpdateSoftwareRasterizer(nullptr);
+
+		TuningConfig bestConfig{ GetTuningConfig() };
+		double bestMs{ MeasureTuningConfig(bestConfig) };
+
+		//One setting at a time starting from the best so far, a full grid takes too long to run on demand
+		const auto tryConfig = [&](const TuningConfig& config)
 			{
-				//Multiply every vertex with this matrix, which is the same for all vertices within one mesh!
-				Vector4 viewSpaceVertex = worldViewProjectionMatrix.TransformPoint({ vertex.position, 1 });
-
-				// Conversion of the normal and tangent from viewspace to world space
-				// This is for the rotation
-				const Vector3 normal = { mesh.worldMatrix.TransformVector(vertex.normal).Normalized() };
-				const Vector3 tangent = { mesh.worldMatrix.TransformVector(vertex.tangent).Normalized() };
-
-				//Conversion to NDC - Perspective Divide (perspective distortion)
-				viewSpaceVertex.x /= viewSpaceVertex.w;
-				viewSpaceVertex.y /= viewSpaceVertex.w;
-				viewSpaceVertex.z /= viewSpaceVertex.w;
-				viewSpaceVertex.w = viewSpaceVertex.w;
-
-				// Calculate the vertex world position to World Space
-				const Vector3 vertexWorldPos = { mesh.worldMatrix.TransformPoint(vertex.position) };
-				// Calculate the viewDirection
-				const Vector3 viewDirection = { m_Camera.origin - vertexWorldPos };
-
-				//Convert to Screen Space
-				Vertex_Out NdcSpaceVertex{};
-				NdcSpaceVertex.position = viewSpaceVertex;			// Copy the position
-				NdcSpaceVertex.uv = vertex.uv;						// Copy the UV
-				NdcSpaceVertex.normal = normal;						// Put in the transformed normal
-				NdcSpaceVertex.tangent = tangent;					// Put in the transformed tangent
-				NdcSpaceVertex.viewDirection = viewDirection;		// Put in the transformed viewDirection
-
-				mesh.vertices_out.emplace_back(NdcSpaceVertex);
-			}
+				if (config.level == bestConfig.level && config.tileSize == bestConfig.tileSize && config.nrWorkers == bestConfig.nrWorkers)
+					return;
+
+				const double ms{ MeasureTuningConfig(config) };
+				if (ms < bestMs)
+				{
+					bestMs = ms;
+					bestConfig = config;
+				}
+			};
+
+		for (ISALevel level : { ISALevel::SSE2, ISALevel::AVX2, ISALevel::AVX512 })
+		{
+			if (level <= CpuFeatures::GetSupportedLevel() && !CpuFeatures::HasOverride())
+				tryConfig(TuningConfig{ level, bestConfig.tileSize, bestConfig.nrWorkers });
 		}
+		for (int tileSize : m_TuningTileSizes)
+		{
+			tryConfig(TuningConfig{ bestConfig.level, tileSize, bestConfig.nrWorkers });
+		}
+		const int maxNrWorkers{ JobSystem::Get().GetNrWorkers() };
+		for (int nrWorkers{ 1 }; ; nrWorkers *= 2)
+		{
+			tryConfig(TuningConfig{ bestConfig.level, bestConfig.tileSize, std::min(nrWorkers, maxNrWorkers) });
+			if (nrWorkers >= maxNrWorkers)
+				break;
+		}
+
+		ApplyTuningConfig(bestConfig);
+		AutoTuner::Save(AutoTuner::GetHostFingerprint(m_Width, m_Height), bestConfig);
+		std::cout << "**(SOFTWARE) Auto-Tune best: " << CpuFeatures::GetName(bestConfig.level) << ", " << bestConfig.tileSize
+			<< " px tiles, " << bestConfig.nrWorkers << " workers, " << bestMs << " ms\n" << RESET;
+	}
+	TuningConfig Renderer::GetTuningConfig() const
+	{
+		return TuningConfig{ GetSoftwareKernels().level, m_pFrameBuffer->GetTileSize(), JobSystem::Get().GetNrActiveWorkers() };
+	}
+	void Renderer::ApplyTuningConfig(const TuningConfig& config)
+	{
+		WaitForSoftwareFrames();
+
+		SetSoftwareKernelLevel(config.level);
+		m_pFrameBuffer->SetTileSize(std::clamp(config.tileSize, FrameBuffer::BlockSize, FrameBuffer::MaxTileSize) / FrameBuffer::BlockSize * FrameBuffer::BlockSize);
+		JobSystem::Get().SetNrActiveWorkers(config.nrWorkers);
+	}
+	double Renderer::MeasureTuningConfig(const TuningConfig& config)
+	{
+		ApplyTuningConfig(config);
+
+		//Whole frames on this thread, vertex & raster stage after each other, so the measurement doesn't depend on the pipeline overlap
+		//Rendered off screen: nothing reaches the swap chain, the sweep runs the same from the hardware rasterizer
+		SoftwareFrame& frame{ m_SoftwareFrames[m_NrSubmittedSoftwareFrames % m_NrSoftwareFrames] };
+		double frameMs[m_NrTuningFrames]{};
+		const double countsToMs{ 1000.0 / double(SDL_GetPerformanceFrequency()) };
+		for (int frameIdx{ -m_NrTuningWarmUpFrames }; frameIdx < m_NrTuningFrames; ++frameIdx)
+		{
+			const uint64_t start{ SDL_GetPerformanceCounter() };
+			PrepareSoftwareFrame(frame);
+			RasterizeSoftwareFrame(frame, false);
+			if (frameIdx >= 0)
+				frameMs[frameIdx] = double(SDL_GetPerformanceCounter() - start) * countsToMs;
+		}
+
+		//Median, a single interrupted frame doesn't decide
+		std::nth_element(frameMs, frameMs + m_NrTuningFrames / 2, frameMs + m_NrTuningFrames);
+		const double medianMs{ frameMs[m_NrTuningFrames / 2] };
+
+		std::cout << "    " << CpuFeatures::GetName(GetSoftwareKernels().level) << ", " << m_pFrameBuffer->GetTileSize() << " px tiles, "
+			<< JobSystem::Get().GetNrActiveWorkers() << " workers: " << medianMs << " ms\n";
+		return medianMs;
 	}
 
 	// SHARED
@@ -655,6 +1357,9 @@ namespace dae {
 		else
 		{
 			std::cout << "HARDWARE\n";
+			// The raster & present thread share the device context with the hardware rasterizer
+			WaitForSoftwareFrames();
+			m_pSoftwarePresenter->Flush();
 			m_DirectXEnabled = true;
 		}
 		std::cout << RESET;
@@ -786,6 +1491,24 @@ namespace dae {
 		}
 		std::wcout << RESET;
 	}
+	void Renderer::ToggleDepthCompression()
+	{
+		if (m_DirectXEnabled)
+			return;
+
+		std::cout << PURPLE << "**(SOFTWARE) Depth Compression ";
+		if (m_DepthCompressionEnabled)
+		{
+			std::cout << "OFF\n";
+			m_DepthCompressionEnabled = false;
+		}
+		else
+		{
+			std::cout << "ON\n";
+			m_DepthCompressionEnabled = true;
+		}
+		std::wcout << RESET;
+	}
 	void Renderer::ToggleBoundingBox()
 	{
 		if (m_DirectXEnabled)
@@ -804,4 +1527,174 @@ namespace dae {
 		}
 		std::wcout << RESET;
 	}
+	void Renderer::ToggleTriangleSort()
+	{
+		if (m_DirectXEnabled)
+			return;
+
+		std::cout << PURPLE << "**(SOFTWARE) Front-to-Back Triangle Sorting ";
+		if (m_TriangleSortEnabled)
+		{
+			std::cout << "OFF\n";
+			m_TriangleSortEnabled = false;
+		}
+		else
+		{
+			std::cout << "ON\n";
+			m_TriangleSortEnabled = true;
+		}
+		std::wcout << RESET;
+	}
+	void Renderer::ToggleMeshletCulling()
+	{
+		if (m_DirectXEnabled)
+			return;
+
+		std::cout << PURPLE << "**(SOFTWARE) Meshlet Culling ";
+		if (m_MeshletCullingEnabled)
+		{
+			std::cout << "OFF\n";
+			m_MeshletCullingEnabled = false;
+		}
+		else
+		{
+			std::cout << "ON\n";
+			m_MeshletCullingEnabled = true;
+		}
+		std::wcout << RESET;
+	}
+	void Renderer::CycleRasterEngine()
+	{
+		if (m_DirectXEnabled)
+			return;
+
+		//The frames in flight keep the engine they were snapshotted with
+		m_RasterEngineIdx = (m_RasterEngineIdx + 1) % GetRasterEngines().size();
+		std::cout << PURPLE << "**(SOFTWARE) Raster Engine = " << GetRasterEngines()[m_RasterEngineIdx].pName << "\n" << RESET;
+	}
+	void Renderer::CycleShadingEngine()
+	{
+		if (m_DirectXEnabled)
+			return;
+
+		m_ShadingEngineIdx = (m_ShadingEngineIdx + 1) % GetShadingEngines().size();
+		std::cout << PURPLE << "**(SOFTWARE) Shading Engine = " << GetShadingEngines()[m_ShadingEngineIdx].pName << "\n" << RESET;
+	}
+	void Renderer::ValidateEngines()
+	{
+		if (m_DirectXEnabled)
+			return;
+
+		const RasterEngine& rasterEngine{ GetRasterEngines()[m_RasterEngineIdx] };
+		const ShadingEngine& shadingEngine{ GetShadingEngines()[m_ShadingEngineIdx] };
+		std::cout << PURPLE << "**(SOFTWARE) Validate " << rasterEngine.pName << " + " << shadingEngine.pName << " against REFERENCE: ";
+
+		//The raster thread is idle, the same frame is rasterized twice on this thread in the slot of the next frame
+		WaitForSoftwareFrames();
+		SoftwareFrame& frame{ m_SoftwareFrames[m_NrSubmittedSoftwareFrames % m_NrSoftwareFrames] };
+		PrepareSoftwareFrame(frame);
+		//Every pixel needs its depth in the buffer to be compared
+		frame.isDepthCompressed = false;
+
+		const size_t nrPixels{ size_t(m_Width) * m_Height };
+		std::vector<uint32_t> referenceColors(nrPixels);
+		std::vector<float> referenceDepths(nrPixels);
+		const auto forEachPixel = [&](const auto& function)
+			{
+				for (int py{ 0 }; py < m_Height; ++py)
+				{
+					for (int px{ 0 }; px < m_Width; ++px)
+						function(size_t(px) + size_t(py) * m_Width, m_pFrameBuffer->GetOffset(px, py));
+				}
+			};
+
+		frame.pRasterEngine = FindRasterEngine("REFERENCE");
+		frame.pShadingEngine = FindShadingEngine("REFERENCE");
+		RasterizeSoftwareFrame(frame, false);
+		forEachPixel([&](size_t pixelIdx, size_t offset)
+			{
+				referenceColors[pixelIdx] = m_pFrameBuffer->GetColor()[offset];
+				referenceDepths[pixelIdx] = m_pFrameBuffer->GetDepth()[offset];
+			});
+
+		//Pixels nothing touched keep the same stale color & depth in both renders, they compare equal
+		frame.pRasterEngine = &rasterEngine;
+		frame.pShadingEngine = &shadingEngine;
+		RasterizeSoftwareFrame(frame, false);
+		size_t nrColorErrors{ 0 };
+		size_t nrDepthErrors{ 0 };
+		int maxColorError{ 0 };
+		float maxDepthError{ 0.f };
+		forEachPixel([&](size_t pixelIdx, size_t offset)
+			{
+				const uint32_t color{ m_pFrameBuffer->GetColor()[offset] };
+				int colorError{ 0 };
+				for (int shift : { 0, 8, 16 })
+					colorError = std::max(colorError, std::abs(int((color >> shift) & 0xFF) - int((referenceColors[pixelIdx] >> shift) & 0xFF)));
+				const float depthError{ std::abs(m_pFrameBuffer->GetDepth()[offset] - referenceDepths[pixelIdx]) };
+
+				nrColorErrors += colorError > m_ValidationColorTolerance;
+				nrDepthErrors += depthError > m_ValidationDepthTolerance;
+				maxColorError = std::max(maxColorError, colorError);
+				maxDepthError = std::max(maxDepthError, depthError);
+			});
+
+		std::cout << ((nrColorErrors == 0 && nrDepthErrors == 0) ? "PASSED\n" : "FAILED\n");
+		std::cout << "    Color: " << nrColorErrors << " pixels over " << m_ValidationColorTolerance << "/255, max " << maxColorError << "/255\n";
+		std::cout << "    Depth: " << nrDepthErrors << " pixels over " << m_ValidationDepthTolerance << ", max " << maxDepthError << "\n" << RESET;
+	}
+	void Renderer::ToggleDeterministic()
+	{
+		if (m_DirectXEnabled)
+			return;
+
+		std::cout << PURPLE << "**(SOFTWARE) Deterministic Schedule ";
+		if (m_DeterministicEnabled)
+		{
+			std::cout << "OFF\n";
+			m_DeterministicEnabled = false;
+		}
+		else
+		{
+			std::cout << "ON\n";
+			m_DeterministicEnabled = true;
+		}
+		std::wcout << RESET;
+	}
+	bool Renderer::CheckDeterminism()
+	{
+		std::cout << PURPLE << "**(SOFTWARE) Determinism check, color & depth hash per thread count:\n";
+
+		//Rendered off screen, so it doesn't need the software rasterizer to be the one on screen - only the vehicle placed
+		UpdateSoftwareRasterizer(nullptr);
+
+		//The raster thread is idle, the same frame is rasterized on this thread with every number of workers
+		//Only the deterministic schedule has to give the same image, it is on for the check whatever Shift + F9 says
+		WaitForSoftwareFrames();
+		const bool isDeterministicAtStart{ m_DeterministicEnabled };
+		m_DeterministicEnabled = true;
+		SoftwareFrame& frame{ m_SoftwareFrames[m_NrSubmittedSoftwareFrames % m_NrSoftwareFrames] };
+		PrepareSoftwareFrame(frame);
+
+		JobSystem& jobSystem{ JobSystem::Get() };
+		const int nrActiveWorkersAtStart{ jobSystem.GetNrActiveWorkers() };
+		uint64_t firstHash{ 0 };
+		bool isDeterministic{ true };
+		for (int nrWorkers{ 0 }; nrWorkers <= jobSystem.GetNrWorkers(); ++nrWorkers)
+		{
+			jobSystem.SetNrActiveWorkers(nrWorkers);
+			RasterizeSoftwareFrame(frame, false);
+
+			const uint64_t hash{ m_pFrameBuffer->GetHash() };
+			if (nrWorkers == 0)
+				firstHash = hash;
+			isDeterministic &= hash == firstHash;
+			std::cout << "    " << jobSystem.GetNrThreads() << " threads: " << std::hex << hash << std::dec << (hash == firstHash ? "\n" : " MISMATCH\n");
+		}
+		jobSystem.SetNrActiveWorkers(nrActiveWorkersAtStart);
+		m_DeterministicEnabled = isDeterministicAtStart;
+
+		std::cout << (isDeterministic ? "    PASSED\n" : "    FAILED\n") << RESET;
+		return isDeterministic;
+	}
 }
@@ -1,19 +1,34 @@
 #pragma once
 #include "Camera.h"
 #include "Texture.h"
+#include "SpecularLUT.h"
+#include "NormalMap.h"
+#include "FrameArena.h"
+#include "AutoTuner.h"
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
 
 struct SDL_Window;
-struct SDL_Surface;
 struct Vertex_Out;
 struct Mesh;
+struct MeshFrame;
+enum class Varying : uint32_t;
 class MeshRepresentation;
 
 namespace dae
 {
+	class FrameBuffer;
+	class SoftwarePresenter;
+	struct RasterEngine;
+	struct ShadingEngine;
+
 	class Renderer final
 	{
 	public:
-		Renderer(SDL_Window* pWindow);
+		Renderer(SDL_Window* pWindow, int presentQueueDepth = 2);
 		~Renderer();
 
 		Renderer(const Renderer&) = delete;
@@ -31,8 +46,11 @@ namespace dae
 		void UpdateSoftwareRasterizer(const Timer* pTimer);
 
 		// Software Rasterizer
-		ColorRGB PixelShading(const Vertex_Out& v)const;
-		void VertexTransformationFunctionW3(std::vector<Mesh>& meshes) const;
+		Varying GetLiveVaryings() const;
+		// Average stage times since the previous call, printed with the FPS
+		void PrintStageTimings();
+		// Calibration sweep of kernel level, tile size & workers against the current scene, the best is saved for this host
+		void AutoTune(); // F9
 
 
 		// KEYS
@@ -44,7 +62,19 @@ namespace dae
 		void CycleShadingMode(); // F5
 		void StateNormalMap(); // F6
 		void ToggleDepthBuffer(); // F7
+		void ToggleDepthCompression(); // Shift + F7
 		void ToggleBoundingBox(); // F8
+		void ToggleTriangleSort(); // Shift + F8
+		void ToggleMeshletCulling(); // Ctrl + F8
+		void CycleRasterEngine(); // F12
+		void CycleShadingEngine(); // Shift + F12
+		// Renders the current frame with the selected engines and with the reference ones, prints the per pixel differences
+		void ValidateEngines(); // Ctrl + F12
+		void ToggleDeterministic(); // Shift + F9
+		void SetDeterministic(bool isDeterministic) { m_DeterministicEnabled = isDeterministic; }
+		// Renders the current frame off screen with the deterministic schedule & 0..N active workers, compares the color & depth hashes, true when they are all equal
+		// Works in either rasterizer mode, also headless from main with --check-determinism
+		bool CheckDeterminism(); // Ctrl + F9
 	private:
 		SDL_Window* m_pWindow{};
 
@@ -62,6 +92,16 @@ namespace dae
 		bool m_FireFXMeshEnabled = { true };
 		bool m_NormalMapEnabled = { true };
 		bool m_DepthBufferEnabled = { false };
+		bool m_DepthCompressionEnabled = { false };
+		bool m_TriangleSortEnabled = { true };
+		// Software meshes are drawn as meshlets, culled per meshlet against the frustum & on their normal cone
+		bool m_MeshletCullingEnabled = { true };
+		// Index in GetRasterEngines()
+		size_t m_RasterEngineIdx{ 0 };
+		// Index in GetShadingEngines()
+		size_t m_ShadingEngineIdx{ 0 };
+		// Fixed tile ownership instead of cost ordered work stealing
+		bool m_DeterministicEnabled = { false };
 		bool m_BoundingBoxVisualizationEnabled = { false };
 
 		// -----------------------------------
@@ -80,12 +120,14 @@ namespace dae
 		// MESH
 		std::vector<MeshRepresentation*> m_pHardwareMeshes;
 		float m_CurrentAngle = { 0.f };
+		// Angle the software mesh world matrices were built with, NaN until the first update
+		float m_SoftwareMeshAngle = { std::numeric_limits<float>::quiet_NaN() };
 
 		MeshRepresentation* m_pMeshFire;
 
 		Texture* m_pDiffuseTexture;
 		Texture* m_pGlossTexture;
-		Texture* m_pNormalTexture;
+		NormalMap* m_pNormalMap;
 		Texture* m_pSpecularTexture;
 		Texture* m_pFireTexture;
 
@@ -93,13 +135,51 @@ namespace dae
 		// X SOFTWARE RASTERIZER
 		// -----------------------------------
 
-		SDL_Surface* m_pFrontBuffer{ nullptr };
-		SDL_Surface* m_pBackBuffer{ nullptr };
-		uint32_t* m_pBackBufferPixels{};
+		SoftwarePresenter* m_pSoftwarePresenter{ nullptr };
 
-		float* m_pDepthBufferPixels{};
+		// Depth buffer & lazy tile clears of the back buffer
+		FrameBuffer* m_pFrameBuffer{ nullptr };
 
 		std::vector<Mesh> m_SoftwareMeshes;
+		// Vertices per vertex stage job
+		static constexpr size_t m_VertexGrainSize{ 2048 };
+		// Visible meshlets per vertex stage job, about m_VertexGrainSize vertices
+		static constexpr size_t m_MeshletGrainSize{ 32 };
+		// Raster scheduling: estimated cost of a triangle in a tile besides its pixels, in pixels
+		static constexpr float m_TileTriangleCost{ 32.f };
+		// A tile is split when it costs more than 1 / m_HotTilesPerThread of the share of one thread, in at most m_MaxTileBands bands
+		static constexpr int m_HotTilesPerThread{ 4 };
+		static constexpr int m_MaxTileBands{ 8 };
+		// Compressed depth: relative margin on the vertex depth range of a triangle, covers the rounding of the interpolated depth
+		static constexpr float m_DepthBoundsMargin{ 1e-5f };
+		// Triangle classes: at most this many pixel centers is tiny, at least this many pixels wide & high is large
+		static constexpr int m_MaxTinyTriangleSamples{ 4 };
+		static constexpr int m_MinLargeTriangleSize{ 16 };
+		// Front-to-back ordering: triangles per sorted cluster & the quantization of the cluster depth
+		static constexpr size_t m_SortClusterSize{ 32 };
+		static constexpr int m_SortKeyBits{ 16 };
+		static constexpr uint32_t m_SortKeyMax{ (1u << m_SortKeyBits) - 1 };
+		// Engine validation: differences up to these are rounding, per 8-bit color channel & in NDC depth
+		static constexpr int m_ValidationColorTolerance{ 1 };
+		static constexpr float m_ValidationDepthTolerance{ 1e-6f };
+
+		// AUTO-TUNE
+		static constexpr int m_TuningTileSizes[]{ 16, 32, 64, 128 };
+		static constexpr int m_NrTuningWarmUpFrames{ 2 };
+		static constexpr int m_NrTuningFrames{ 9 };
+		TuningConfig GetTuningConfig() const;
+		// Only between frames, waits for the frames in flight
+		void ApplyTuningConfig(const TuningConfig& config);
+		// Median time of a whole software frame with the config rendered off screen, in ms
+		double MeasureTuningConfig(const TuningConfig& config);
+
+		// Performance counts of the vertex (main thread) & raster stage (raster thread), summed until the next PrintStageTimings
+		std::atomic<uint64_t> m_SoftwareVertexCounts{};
+		std::atomic<uint64_t> m_SoftwareRasterCounts{};
+		std::atomic<uint32_t> m_NrTimedSoftwareFrames{};
+
+		// powf(cosAlpha, gloss * shininess) per gloss level, shininess = 25
+		SpecularLUT m_SpecularLUT{ 25.f };
 
 		enum class LightingMode
 		{
@@ -109,5 +189,58 @@ namespace dae
 			Combined		//ObservedArea * Diffuse * Specular
 		};
 		LightingMode m_CurrentLightingMode = LightingMode::Combined;
+
+		// PIPELINED FRAMES
+		// The main thread updates, snapshots and vertex transforms frame N + 1 while the raster thread rasterizes frame N
+		// Everything a frame reads that can change is copied in its snapshot, the stages never share mutable state
+		struct SoftwareFrame
+		{
+			// Camera
+			Matrix viewMatrix{};
+			Matrix projectionMatrix{};
+			Frustum frustum{};
+			Vector3 cameraOrigin{};
+
+			// Settings
+			LightingMode lightingMode{};
+			Varying liveVaryings{};
+			ColorRGB clearColor{};
+			bool isNormalMapEnabled{};
+			bool isDepthBufferEnabled{};
+			bool isDepthCompressed{};
+			bool isTriangleSortEnabled{};
+			bool isMeshletCullingEnabled{};
+			const RasterEngine* pRasterEngine{ nullptr };
+			const ShadingEngine* pShadingEngine{ nullptr };
+			bool isDeterministic{};
+			bool isBoundingBoxVisualizationEnabled{};
+
+			// Same order as m_SoftwareMeshes, sized once
+			std::vector<MeshFrame> meshes;
+
+			// Post-transform vertex streams, reset when the main thread reuses this frame
+			FrameArena arena{ 4 * 1024 * 1024 };
+		};
+		static constexpr uint64_t m_NrSoftwareFrames{ 2 };
+		SoftwareFrame m_SoftwareFrames[m_NrSoftwareFrames];
+
+		// Frame n uses m_SoftwareFrames[n % m_NrSoftwareFrames], both counters only grow
+		std::mutex m_SoftwareFrameMutex{};
+		std::condition_variable m_SoftwareFrameChanged{};
+		uint64_t m_NrSubmittedSoftwareFrames{};
+		uint64_t m_NrRasterizedSoftwareFrames{};
+		bool m_IsStoppingRasterThread{ false };
+		std::thread m_RasterThread{};
+
+		ColorRGB PixelShading(const Vertex_Out& v, const SoftwareFrame& frame)const;
+		void VertexTransformationFunctionW3(const std::vector<Mesh>& meshes, SoftwareFrame& frame) const;
+		// Snapshot & vertex stage of a frame, the raster thread can't be using it
+		void PrepareSoftwareFrame(SoftwareFrame& frame);
+		// isPresented: false for frames that are only read back from the frame buffer, e.g. validation - no Resolve, no Present
+		void RasterizeSoftwareFrame(const SoftwareFrame& frame, bool isPresented = true);
+
+		void RasterThreadLoop();
+		// Blocks until the raster thread finished every submitted frame
+		void WaitForSoftwareFrames();
 	};
 }
@@ -0,0 +1,56 @@
+#pragma once
+
+// Thin wrapper around the 4-wide float registers of the target, used by Vector4 & Matrix
+// SSE on x64, NEON on ARM64, plain floats everywhere else
+#if defined(_M_ARM64) || defined(__aarch64__)
+#define DAE_SIMD_NEON
+#include <arm_neon.h>
+#elif defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+#define DAE_SIMD_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace dae
+{
+	namespace simd
+	{
+#if defined(DAE_SIMD_SSE)
+		using Float4 = __m128;
+
+		// p has to be 16-byte aligned
+		inline Float4 Load(const float* p) { return _mm_load_ps(p); }
+		inline void Store(float* p, Float4 v) { _mm_store_ps(p, v); }
+		inline Float4 Splat(float s) { return _mm_set1_ps(s); }
+		inline Float4 Add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+		inline Float4 Sub(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+		inline Float4 Mul(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+#elif defined(DAE_SIMD_NEON)
+		using Float4 = float32x4_t;
+
+		inline Float4 Load(const float* p) { return vld1q_f32(p); }
+		inline void Store(float* p, Float4 v) { vst1q_f32(p, v); }
+		inline Float4 Splat(float s) { return vdupq_n_f32(s); }
+		inline Float4 Add(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+		inline Float4 Sub(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+		inline Float4 Mul(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+#else
+		struct Float4
+		{
+			float v[4];
+		};
+
+		inline Float4 Load(const float* p) { return { p[0], p[1], p[2], p[3] }; }
+		inline void Store(float* p, Float4 v) { p[0] = v.v[0]; p[1] = v.v[1]; p[2] = v.v[2]; p[3] = v.v[3]; }
+		inline Float4 Splat(float s) { return { s, s, s, s }; }
+		inline Float4 Add(Float4 a, Float4 b) { return { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] }; }
+		inline Float4 Sub(Float4 a, Float4 b) { return { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] }; }
+		inline Float4 Mul(Float4 a, Float4 b) { return { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] }; }
+#endif
+
+		// x * r0 + y * r1 + z * r2 + w * r3, added in the same order as the scalar code
+		inline Float4 Combine(Float4 r0, Float4 r1, Float4 r2, Float4 r3, float x, float y, float z, float w)
+		{
+			return Add(Add(Add(Mul(Splat(x), r0), Mul(Splat(y), r1)), Mul(Splat(z), r2)), Mul(Splat(w), r3));
+		}
+	}
+}
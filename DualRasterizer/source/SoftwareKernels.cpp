@@ -0,0 +1,49 @@
+#include "pch.h"
+#include "SoftwareKernels.h"
+#include <atomic>
+
+namespace dae
+{
+	// Defined in SoftwareKernels_<level>.cpp
+	namespace SSE2 { const SoftwareKernels& GetKernels(); }
+	namespace AVX2 { const SoftwareKernels& GetKernels(); }
+	namespace AVX512 { const SoftwareKernels& GetKernels(); }
+
+	namespace
+	{
+		const SoftwareKernels& GetKernelsOfLevel(ISALevel level)
+		{
+			switch (level)
+			{
+			case ISALevel::AVX512:
+				return AVX512::GetKernels();
+			case ISALevel::AVX2:
+				return AVX2::GetKernels();
+			case ISALevel::SSE2:
+				break;
+			}
+			return SSE2::GetKernels();
+		}
+
+		// nullptr until the first use, then the table of the active level or the one that was set
+		std::atomic<const SoftwareKernels*> g_pKernels{ nullptr };
+	}
+
+	const SoftwareKernels& GetSoftwareKernels()
+	{
+		const SoftwareKernels* pKernels{ g_pKernels.load(std::memory_order_acquire) };
+		if (pKernels == nullptr)
+		{
+			const SoftwareKernels* pActiveKernels{ &GetKernelsOfLevel(CpuFeatures::GetActiveLevel()) };
+			g_pKernels.compare_exchange_strong(pKernels, pActiveKernels, std::memory_order_acq_rel);
+			pKernels = g_pKernels.load(std::memory_order_acquire);
+		}
+		return *pKernels;
+	}
+
+	void SetSoftwareKernelLevel(ISALevel level)
+	{
+		const ISALevel supportedLevel{ CpuFeatures::GetSupportedLevel() };
+		g_pKernels.store(&GetKernelsOfLevel(level < supportedLevel ? level : supportedLevel), std::memory_order_release);
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "CpuFeatures.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	// Per triangle constants of the edge functions, in raster space
+	struct TriangleSetup
+	{
+		Vector2 a, b, c;
+		Vector2 ab, bc, ca;
+		float totalArea;
+		float invDepthZA, invDepthZB, invDepthZC;
+	};
+
+	// Pixel of one row that passed the coverage and the depth test
+	struct Fragment
+	{
+		int px;
+		float weightA, weightB, weightC;
+		float depthZ;
+	};
+
+	// Pixels of a rectangle that a triangle covers
+	enum class BlockCoverage : uint8_t
+	{
+		Outside,	//None
+		Partial,	//Some, maybe none
+		Inside		//All
+	};
+
+	// Post-transform attributes of the corners of a triangle, nullptr when the varying isn't live
+	struct TriangleVaryings
+	{
+		float invDepthW[3];
+		const Vector2* pUV[3];
+		const Vector3* pNormal[3];
+		const Vector3* pTangent[3];
+		const Vector3* pViewDirection[3];
+	};
+
+	// Hot loops of the software rasterizer, compiled once per ISALevel in SoftwareKernels_<level>.cpp
+	// Matrices are passed as 16 row-major floats, like the effect variables
+	struct SoftwareKernels
+	{
+		ISALevel level;
+
+		// Vertex transform: world view projection, perspective divide & viewport, w = 1 / view space depth
+		void (*TransformPositions)(const float* pWorldViewProjection, const Vertex* pVertices, size_t nrVertices,
+			float width, float height, Vector4* pPositions);
+		// Vertex transform: attributes to world space, a nullptr output stream is skipped
+		void (*TransformAttributes)(const float* pWorld, const Vector3& cameraOrigin, const Vertex* pVertices, size_t nrVertices,
+			Vector2* pUVs, Vector3* pNormals, Vector3* pTangents, Vector3* pViewDirections);
+
+		// Raster: coverage & depth test of the pixels [pxBegin, pxEnd) of row py, pDepth is the depth of pxBegin & the pixels after it
+		// Covered pixels that pass write their depth and are appended to pFragments, returns the number of fragments
+		int (*RasterizeRow)(const TriangleSetup& setup, int py, int pxBegin, int pxEnd, float* pDepth, Fragment* pFragments);
+		// Raster: RasterizeRow without the coverage test, for rows of a rectangle ClassifyBlock found Inside
+		int (*RasterizeInsideRow)(const TriangleSetup& setup, int py, int pxBegin, int pxEnd, float* pDepth, Fragment* pFragments);
+		// Raster: coverage of the pixels [pxBegin, pxEnd) x [pyBegin, pyEnd) from the edge functions at its corners,
+		// exact for the coverage test of RasterizeRow
+		BlockCoverage (*ClassifyBlock)(const TriangleSetup& setup, int pxBegin, int pyBegin, int pxEnd, int pyEnd);
+		// Raster: the covered pixels [*pSpanBegin, *pSpanEnd) of [pxBegin, pxEnd) in row py, from where the edges cross the row
+		// Exact for the coverage test of RasterizeRow, the covered pixels of a row are always one run
+		void (*FindRowSpan)(const TriangleSetup& setup, int py, int pxBegin, int pxEnd, int* pSpanBegin, int* pSpanEnd);
+
+		// Shading: perspective correct interpolation of the live varyings, the input of the pixel shader
+		void (*InterpolateFragments)(const TriangleVaryings& varyings, const Fragment* pFragments, int nrFragments, int py,
+			Vertex_Out* pVertices);
+
+		// Texture decode: 8-bit RGB normal map texels to octahedral snorm8x2
+		void (*EncodeNormals)(const uint8_t* pRGB, size_t nrTexels, uint16_t* pTexels);
+	};
+
+	// Kernels of the active ISA level, selected on first use
+	const SoftwareKernels& GetSoftwareKernels();
+	// Switches the kernels at runtime, e.g. for the auto-tuner - clamped to the supported level
+	// Only between frames, a frame keeps using the table it started with
+	void SetSoftwareKernelLevel(ISALevel level);
+}
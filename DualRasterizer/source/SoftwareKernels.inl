@@ -0,0 +1,404 @@
+// Kernel bodies of SoftwareKernels.h, included once per ISA level by SoftwareKernels_<level>.cpp
+// The including file defines SOFTWARE_KERNELS_ISA (namespace and ISALevel name) and is compiled with that /arch
+//
+// Only plain data and the static helpers of this file may be used in here: an inline function of a shared header
+// (Vector3::Normalized, std::min, ...) is emitted in every object file and the linker keeps one copy,
+// which could be the AVX-512 one that the rest of the program then calls on an SSE4 host.
+// The loops are written branch free where possible so the compiler can vectorize them for the target level.
+
+#include <cmath>
+#include "SoftwareKernels.h"
+
+#if !defined(SOFTWARE_KERNELS_ISA)
+#error "SOFTWARE_KERNELS_ISA has to be defined before including SoftwareKernels.inl"
+#endif
+
+namespace dae
+{
+	namespace SOFTWARE_KERNELS_ISA
+	{
+		namespace
+		{
+			// Number of pixels the row kernel tests at once before it compacts the passed ones
+			constexpr int RasterChunkSize{ 16 };
+
+			float ClampKernel(float v, float min, float max)
+			{
+				return v < min ? min : (v > max ? max : v);
+			}
+
+			// Same operations as Vector3::Normalized
+			void StoreNormalized(float x, float y, float z, Vector3& out)
+			{
+				const float m = sqrtf(x * x + y * y + z * z);
+				out.x = x / m;
+				out.y = y / m;
+				out.z = z / m;
+			}
+
+			// Same operations as Matrix::TransformVector & Matrix::TransformPoint, m is row-major
+			void TransformVector(const float* m, const Vector3& v, float& x, float& y, float& z)
+			{
+				x = m[0] * v.x + m[4] * v.y + m[8] * v.z;
+				y = m[1] * v.x + m[5] * v.y + m[9] * v.z;
+				z = m[2] * v.x + m[6] * v.y + m[10] * v.z;
+			}
+
+			void TransformPoint(const float* m, const Vector3& p, float& x, float& y, float& z)
+			{
+				x = m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12];
+				y = m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13];
+				z = m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14];
+			}
+
+			uint16_t EncodeOctahedral(float nx, float ny, float nz)
+			{
+				//Project on the octahedron |x| + |y| + |z| = 1, fold the lower hemisphere over the diagonals
+				const float invL1Norm{ 1.f / (fabsf(nx) + fabsf(ny) + fabsf(nz)) };
+				float x{ nx * invL1Norm };
+				float y{ ny * invL1Norm };
+				if (nz < 0.f)
+				{
+					const float foldedX{ (1.f - fabsf(y)) * (x >= 0.f ? 1.f : -1.f) };
+					const float foldedY{ (1.f - fabsf(x)) * (y >= 0.f ? 1.f : -1.f) };
+					x = foldedX;
+					y = foldedY;
+				}
+
+				//[-1, 1] -> snorm8
+				const int8_t qx{ static_cast<int8_t>(lroundf(ClampKernel(x, -1.f, 1.f) * 127.f)) };
+				const int8_t qy{ static_cast<int8_t>(lroundf(ClampKernel(y, -1.f, 1.f) * 127.f)) };
+				return static_cast<uint16_t>(uint8_t(qx) | uint8_t(qy) << 8);
+			}
+
+			void TransformPositions(const float* pWorldViewProjection, const Vertex* pVertices, size_t nrVertices,
+				float width, float height, Vector4* pPositions)
+			{
+				const float* m{ pWorldViewProjection };
+				for (size_t i{ 0 }; i < nrVertices; ++i)
+				{
+					const Vector3& p{ pVertices[i].position };
+
+					//Projection, the point has w = 1
+					const float x{ m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12] };
+					const float y{ m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13] };
+					const float z{ m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14] };
+					const float w{ m[3] * p.x + m[7] * p.y + m[11] * p.z + m[15] };
+
+					//Perspective divide
+					const float invDepthW{ 1.f / w };
+					const float ndcX{ x * invDepthW };
+					const float ndcY{ y * invDepthW };
+					const float ndcZ{ z * invDepthW };
+
+					//NDC to raster space
+					Vector4& position{ pPositions[i] };
+					position.x = ((ndcX + 1) / 2.f) * width;
+					position.y = ((1 - ndcY) / 2.f) * height;
+					position.z = ndcZ;
+					position.w = invDepthW;
+				}
+			}
+
+			void TransformAttributes(const float* pWorld, const Vector3& cameraOrigin, const Vertex* pVertices, size_t nrVertices,
+				Vector2* pUVs, Vector3* pNormals, Vector3* pTangents, Vector3* pViewDirections)
+			{
+				// One loop per stream, so every loop is branch free
+				if (pUVs)
+				{
+					for (size_t i{ 0 }; i < nrVertices; ++i)
+					{
+						pUVs[i].x = pVertices[i].uv.x;
+						pUVs[i].y = pVertices[i].uv.y;
+					}
+				}
+				if (pNormals)
+				{
+					for (size_t i{ 0 }; i < nrVertices; ++i)
+					{
+						float x, y, z;
+						TransformVector(pWorld, pVertices[i].normal, x, y, z);
+						StoreNormalized(x, y, z, pNormals[i]);
+					}
+				}
+				if (pTangents)
+				{
+					for (size_t i{ 0 }; i < nrVertices; ++i)
+					{
+						float x, y, z;
+						TransformVector(pWorld, pVertices[i].tangent, x, y, z);
+						StoreNormalized(x, y, z, pTangents[i]);
+					}
+				}
+				if (pViewDirections)
+				{
+					for (size_t i{ 0 }; i < nrVertices; ++i)
+					{
+						float x, y, z;
+						TransformPoint(pWorld, pVertices[i].position, x, y, z);
+						pViewDirections[i].x = cameraOrigin.x - x;
+						pViewDirections[i].y = cameraOrigin.y - y;
+						pViewDirections[i].z = cameraOrigin.z - z;
+					}
+				}
+			}
+
+			// IsInside: the caller knows every pixel is covered, only the depth test is left
+			template<bool IsInside>
+			int RasterizeRowOf(const TriangleSetup& setup, int py, int pxBegin, int pxEnd, float* pDepth, Fragment* pFragments)
+			{
+				const float pointY{ float(py) + 0.5f };
+				const float apY{ pointY - setup.a.y };
+				const float bpY{ pointY - setup.b.y };
+				const float cpY{ pointY - setup.c.y };
+
+				int nrFragments{ 0 };
+				for (int chunkBegin{ pxBegin }; chunkBegin < pxEnd; chunkBegin += RasterChunkSize)
+				{
+					const int chunkSize{ pxEnd - chunkBegin < RasterChunkSize ? pxEnd - chunkBegin : RasterChunkSize };
+
+					float weightsA[RasterChunkSize];
+					float weightsB[RasterChunkSize];
+					float weightsC[RasterChunkSize];
+					float depths[RasterChunkSize];
+					bool passed[RasterChunkSize];
+
+					//Edge functions, weights, depth and depth test of the whole chunk without branches
+					for (int i{ 0 }; i < chunkSize; ++i)
+					{
+						const float pointX{ float(chunkBegin + i) + 0.5f };
+
+						//Same operations as Vector2::Cross(AP, AB), Cross(BP, BC) & Cross(CP, CA)
+						const float signedParallelogramAB{ (pointX - setup.a.x) * setup.ab.y - apY * setup.ab.x };
+						const float signedParallelogramBC{ (pointX - setup.b.x) * setup.bc.y - bpY * setup.bc.x };
+						const float signedParallelogramCA{ (pointX - setup.c.x) * setup.ca.y - cpY * setup.ca.x };
+
+						const float weightA{ signedParallelogramBC / setup.totalArea };
+						const float weightB{ signedParallelogramCA / setup.totalArea };
+						const float weightC{ signedParallelogramAB / setup.totalArea };
+
+						const float interpolatedDepthZ{ 1 / (
+							(setup.invDepthZA * weightA) +
+							(setup.invDepthZB * weightB) +
+							(setup.invDepthZC * weightC)) };
+
+						const float depth{ pDepth[chunkBegin - pxBegin + i] };
+						const bool isPassed{ (IsInside || (signedParallelogramAB > 0 && signedParallelogramBC > 0 && signedParallelogramCA > 0))
+							&& !(interpolatedDepthZ > depth) };
+
+						pDepth[chunkBegin - pxBegin + i] = isPassed ? interpolatedDepthZ : depth;
+						weightsA[i] = weightA;
+						weightsB[i] = weightB;
+						weightsC[i] = weightC;
+						depths[i] = interpolatedDepthZ;
+						passed[i] = isPassed;
+					}
+
+					//Compact the passed pixels, still from left to right
+					for (int i{ 0 }; i < chunkSize; ++i)
+					{
+						if (!passed[i])
+							continue;
+
+						Fragment& fragment{ pFragments[nrFragments++] };
+						fragment.px = chunkBegin + i;
+						fragment.weightA = weightsA[i];
+						fragment.weightB = weightsB[i];
+						fragment.weightC = weightsC[i];
+						fragment.depthZ = depths[i];
+					}
+				}
+				return nrFragments;
+			}
+
+			int RasterizeRow(const TriangleSetup& setup, int py, int pxBegin, int pxEnd, float* pDepth, Fragment* pFragments)
+			{
+				return RasterizeRowOf<false>(setup, py, pxBegin, pxEnd, pDepth, pFragments);
+			}
+
+			int RasterizeInsideRow(const TriangleSetup& setup, int py, int pxBegin, int pxEnd, float* pDepth, Fragment* pFragments)
+			{
+				return RasterizeRowOf<true>(setup, py, pxBegin, pxEnd, pDepth, pFragments);
+			}
+
+			// Narrows [spanBegin, spanEnd) of a row to the pixels inside one edge: pointA is a corner of the edge, edge its vector
+			// The rounded edge function only grows or only shrinks along the row, so those pixels are one run
+			void ClipSpanToEdge(const Vector2& pointA, const Vector2& edge, float apY, int& spanBegin, int& spanEnd)
+			{
+				if (spanBegin >= spanEnd)
+					return;
+
+				//Same operations as RasterizeRowOf
+				const auto isInside = [&](int px)
+					{
+						const float pointX{ float(px) + 0.5f };
+						return (pointX - pointA.x) * edge.y - apY * edge.x > 0;
+					};
+
+				//Parallel to the row: the whole row is on one side
+				if (edge.y == 0.f)
+				{
+					if (!isInside(spanBegin))
+						spanEnd = spanBegin;
+					return;
+				}
+
+				//Pixel right of the intersection of the edge with the row, only a guess: the tests below decide
+				const float intersectionX{ pointA.x + apY * edge.x / edge.y };
+				const float guess{ floorf(intersectionX - 0.5f) + 1.f };
+				int px{ spanBegin };
+				if (guess >= float(spanEnd))
+					px = spanEnd;
+				else if (guess > float(spanBegin))
+					px = int(guess);
+
+				if (edge.y > 0.f)
+				{
+					//Inside to the right, px ends on the first inside pixel
+					while (px > spanBegin && isInside(px - 1))
+						--px;
+					while (px < spanEnd && !isInside(px))
+						++px;
+					spanBegin = px;
+				}
+				else
+				{
+					//Inside to the left, px ends on the first outside pixel
+					while (px > spanBegin && !isInside(px - 1))
+						--px;
+					while (px < spanEnd && isInside(px))
+						++px;
+					spanEnd = px;
+				}
+			}
+
+			void FindRowSpan(const TriangleSetup& setup, int py, int pxBegin, int pxEnd, int* pSpanBegin, int* pSpanEnd)
+			{
+				const float pointY{ float(py) + 0.5f };
+				int spanBegin{ pxBegin };
+				int spanEnd{ pxEnd };
+				ClipSpanToEdge(setup.a, setup.ab, pointY - setup.a.y, spanBegin, spanEnd);
+				ClipSpanToEdge(setup.b, setup.bc, pointY - setup.b.y, spanBegin, spanEnd);
+				ClipSpanToEdge(setup.c, setup.ca, pointY - setup.c.y, spanBegin, spanEnd);
+
+				*pSpanBegin = spanBegin;
+				*pSpanEnd = spanBegin < spanEnd ? spanEnd : spanBegin;
+			}
+
+			BlockCoverage ClassifyBlock(const TriangleSetup& setup, int pxBegin, int pyBegin, int pxEnd, int pyEnd)
+			{
+				//Edge functions at the 4 corner pixels, with the exact operations of RasterizeRowOf
+				//Per edge the rounded value only grows or only shrinks along x and along y, so the corners bound every pixel
+				const float pointsX[2]{ float(pxBegin) + 0.5f, float(pxEnd - 1) + 0.5f };
+				const float pointsY[2]{ float(pyBegin) + 0.5f, float(pyEnd - 1) + 0.5f };
+
+				int nrInsideAB{ 0 }, nrInsideBC{ 0 }, nrInsideCA{ 0 };
+				for (const float pointY : pointsY)
+				{
+					const float apY{ pointY - setup.a.y };
+					const float bpY{ pointY - setup.b.y };
+					const float cpY{ pointY - setup.c.y };
+					for (const float pointX : pointsX)
+					{
+						nrInsideAB += (pointX - setup.a.x) * setup.ab.y - apY * setup.ab.x > 0;
+						nrInsideBC += (pointX - setup.b.x) * setup.bc.y - bpY * setup.bc.x > 0;
+						nrInsideCA += (pointX - setup.c.x) * setup.ca.y - cpY * setup.ca.x > 0;
+					}
+				}
+
+				if (nrInsideAB == 0 || nrInsideBC == 0 || nrInsideCA == 0)
+					return BlockCoverage::Outside;
+				if (nrInsideAB == 4 && nrInsideBC == 4 && nrInsideCA == 4)
+					return BlockCoverage::Inside;
+				return BlockCoverage::Partial;
+			}
+
+			void InterpolateFragments(const TriangleVaryings& varyings, const Fragment* pFragments, int nrFragments, int py,
+				Vertex_Out* pVertices)
+			{
+				const bool isUVLive{ varyings.pUV[0] != nullptr };
+				const bool isNormalLive{ varyings.pNormal[0] != nullptr };
+				const bool isTangentLive{ varyings.pTangent[0] != nullptr };
+				const bool isViewDirectionLive{ varyings.pViewDirection[0] != nullptr };
+
+				for (int i{ 0 }; i < nrFragments; ++i)
+				{
+					const Fragment& fragment{ pFragments[i] };
+
+					//Divide each live attribute by the original vertex depth - w already holds 1 / Vw
+					const float perspectiveWeightA{ fragment.weightA * varyings.invDepthW[0] };
+					const float perspectiveWeightB{ fragment.weightB * varyings.invDepthW[1] };
+					const float perspectiveWeightC{ fragment.weightC * varyings.invDepthW[2] };
+
+					//WbufferValue - linear
+					const float interpolatedDepthW{ 1 / (perspectiveWeightA + perspectiveWeightB + perspectiveWeightC) };
+
+					Vertex_Out& vertOut{ pVertices[i] };
+					vertOut.position.x = float(fragment.px);
+					vertOut.position.y = float(py);
+					vertOut.position.z = fragment.depthZ;
+					vertOut.position.w = interpolatedDepthW;
+
+					if (isUVLive)
+					{
+						const Vector2& uvA{ *varyings.pUV[0] };
+						const Vector2& uvB{ *varyings.pUV[1] };
+						const Vector2& uvC{ *varyings.pUV[2] };
+						vertOut.uv.x = (uvA.x * perspectiveWeightA + uvB.x * perspectiveWeightB + uvC.x * perspectiveWeightC) * interpolatedDepthW;
+						vertOut.uv.y = (uvA.y * perspectiveWeightA + uvB.y * perspectiveWeightB + uvC.y * perspectiveWeightC) * interpolatedDepthW;
+					}
+
+					//Normalized afterwards, so no need to multiply with the interpolated depth
+					const auto interpolateNormalized = [&](const Vector3* const* pCorners, Vector3& out)
+						{
+							const Vector3& a{ *pCorners[0] };
+							const Vector3& b{ *pCorners[1] };
+							const Vector3& c{ *pCorners[2] };
+							StoreNormalized(
+								a.x * perspectiveWeightA + b.x * perspectiveWeightB + c.x * perspectiveWeightC,
+								a.y * perspectiveWeightA + b.y * perspectiveWeightB + c.y * perspectiveWeightC,
+								a.z * perspectiveWeightA + b.z * perspectiveWeightB + c.z * perspectiveWeightC,
+								out);
+						};
+
+					if (isNormalLive)
+						interpolateNormalized(varyings.pNormal, vertOut.normal);
+					if (isTangentLive)
+						interpolateNormalized(varyings.pTangent, vertOut.tangent);
+					if (isViewDirectionLive)
+						interpolateNormalized(varyings.pViewDirection, vertOut.viewDirection);
+				}
+			}
+
+			void EncodeNormals(const uint8_t* pRGB, size_t nrTexels, uint16_t* pTexels)
+			{
+				for (size_t i{ 0 }; i < nrTexels; ++i)
+				{
+					//[0, 255] -> [-1, 1]
+					const float x{ pRGB[i * 3 + 0] / 127.5f - 1.f };
+					const float y{ pRGB[i * 3 + 1] / 127.5f - 1.f };
+					const float z{ pRGB[i * 3 + 2] / 127.5f - 1.f };
+
+					const float m = sqrtf(x * x + y * y + z * z);
+					pTexels[i] = EncodeOctahedral(x / m, y / m, z / m);
+				}
+			}
+		}
+
+		const SoftwareKernels& GetKernels()
+		{
+			static const SoftwareKernels kernels{
+				ISALevel::SOFTWARE_KERNELS_ISA,
+				&TransformPositions,
+				&TransformAttributes,
+				&RasterizeRow,
+				&RasterizeInsideRow,
+				&ClassifyBlock,
+				&FindRowSpan,
+				&InterpolateFragments,
+				&EncodeNormals
+			};
+			return kernels;
+		}
+	}
+}
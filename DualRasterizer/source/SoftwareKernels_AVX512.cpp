@@ -0,0 +1,3 @@
+// Software kernels for AVX512 hosts, compiled without the precompiled header because its /arch differs
+#define SOFTWARE_KERNELS_ISA AVX512
+#include "SoftwareKernels.inl"
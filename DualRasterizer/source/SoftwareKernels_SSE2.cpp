@@ -0,0 +1,3 @@
+// Software kernels for the x64 baseline, compiled with the default /arch like the rest of the project
+#define SOFTWARE_KERNELS_ISA SSE2
+#include "SoftwareKernels.inl"
@@ -0,0 +1,175 @@
+#include "pch.h"
+#include "SoftwarePresenter.h"
+#include "FrameArena.h"
+#include <cassert>
+
+namespace dae
+{
+	SoftwarePresenter::SoftwarePresenter(SDL_Window* pWindow, int width, int height, int queueDepth,
+		ID3D11DeviceContext* pDeviceContext, IDXGISwapChain* pSwapChain, ID3D11Resource* pSwapChainBuffer)
+		: m_pWindow{ pWindow }
+		, m_Width{ width }
+		, m_Height{ height }
+		, m_QueueDepth{ size_t(queueDepth) }
+		, m_pDeviceContext{ pDeviceContext }
+		, m_pSwapChain{ pSwapChain }
+		, m_pSwapChainBuffer{ pSwapChainBuffer }
+	{
+		assert(queueDepth >= 1 && "ERROR: the present queue needs room for at least one frame");
+
+		m_pBuffers.resize(m_QueueDepth + 2);
+		for (uint32_t*& pBuffer : m_pBuffers)
+		{
+			pBuffer = static_cast<uint32_t*>(::operator new(sizeof(uint32_t) * width * height, std::align_val_t{ CacheLineSize }));
+		}
+
+		m_QueuedIndices.resize(m_QueueDepth);
+		m_FreeIndices.reserve(m_pBuffers.size());
+
+		//Buffer 0 is the first back buffer
+		for (int i{ int(m_pBuffers.size()) - 1 }; i > 0; --i)
+		{
+			m_FreeIndices.push_back(i);
+		}
+
+		//Without a swap chain the main thread presents, see PresentToWindow
+		if (m_pSwapChain)
+			m_PresentThread = std::thread{ &SoftwarePresenter::PresentThreadLoop, this };
+	}
+
+	SoftwarePresenter::~SoftwarePresenter()
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsStopping = true;
+		}
+		m_QueueChanged.notify_all();
+		if (m_PresentThread.joinable())
+			m_PresentThread.join();
+
+		for (uint32_t* pBuffer : m_pBuffers)
+		{
+			::operator delete(pBuffer, std::align_val_t{ CacheLineSize });
+		}
+	}
+
+	void SoftwarePresenter::Present()
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+
+			//Backpressure: drop the oldest frame that is still waiting instead of blocking the render loop
+			if (m_QueueSize == m_QueueDepth)
+			{
+				m_FreeIndices.push_back(m_QueuedIndices[m_QueueFront]);
+				m_QueueFront = (m_QueueFront + 1) % m_QueueDepth;
+				--m_QueueSize;
+				++m_Statistics.nrDroppedFrames;
+			}
+			m_QueuedIndices[(m_QueueFront + m_QueueSize) % m_QueueDepth] = m_BackBufferIndex;
+			++m_QueueSize;
+
+			//There is always a free buffer: at most m_QueueDepth are queued and one is being presented
+			assert(!m_FreeIndices.empty() && "ERROR: no free buffer to render the next frame in!");
+			m_BackBufferIndex = m_FreeIndices.back();
+			m_FreeIndices.pop_back();
+		}
+		m_QueueChanged.notify_all();
+	}
+
+	void SoftwarePresenter::PresentToWindow()
+	{
+		if (m_pSwapChain)
+			return;
+
+		std::unique_lock lock{ m_Mutex };
+		if (m_QueueSize == 0)
+			return;
+
+		//The window only shows the last frame, the ones queued before it are dropped
+		while (m_QueueSize > 1)
+		{
+			m_FreeIndices.push_back(m_QueuedIndices[m_QueueFront]);
+			m_QueueFront = (m_QueueFront + 1) % m_QueueDepth;
+			--m_QueueSize;
+			++m_Statistics.nrDroppedFrames;
+		}
+
+		const int index{ m_QueuedIndices[m_QueueFront] };
+		m_QueueFront = (m_QueueFront + 1) % m_QueueDepth;
+		--m_QueueSize;
+		PresentBuffer(index, lock);
+	}
+
+	void SoftwarePresenter::Flush()
+	{
+		PresentToWindow();
+
+		std::unique_lock lock{ m_Mutex };
+		m_QueueChanged.wait(lock, [this]() { return m_QueueSize == 0 && !m_IsPresenting; });
+	}
+
+	SoftwarePresenter::Statistics SoftwarePresenter::TakeStatistics()
+	{
+		std::lock_guard lock{ m_Mutex };
+		const Statistics statistics{ m_Statistics };
+		m_Statistics = {};
+		return statistics;
+	}
+
+	void SoftwarePresenter::PresentThreadLoop()
+	{
+		std::unique_lock lock{ m_Mutex };
+		while (true)
+		{
+			m_QueueChanged.wait(lock, [this]() { return m_IsStopping || m_QueueSize > 0; });
+			if (m_IsStopping)
+				return;
+
+			const int index{ m_QueuedIndices[m_QueueFront] };
+			m_QueueFront = (m_QueueFront + 1) % m_QueueDepth;
+			--m_QueueSize;
+			PresentBuffer(index, lock);
+		}
+	}
+
+	void SoftwarePresenter::PresentBuffer(int index, std::unique_lock<std::mutex>& lock)
+	{
+		m_IsPresenting = true;
+
+		lock.unlock();
+		const uint64_t presentStart{ SDL_GetPerformanceCounter() };
+		Upload(m_pBuffers[index]);
+		const uint64_t presentEnd{ SDL_GetPerformanceCounter() };
+		lock.lock();
+
+		m_IsPresenting = false;
+		m_FreeIndices.push_back(index);
+		m_Statistics.presentCounts += presentEnd - presentStart;
+		++m_Statistics.nrPresentedFrames;
+		m_QueueChanged.notify_all();
+	}
+
+	void SoftwarePresenter::Upload(const uint32_t* pBuffer) const
+	{
+		const size_t rowSize{ sizeof(uint32_t) * m_Width };
+
+		if (m_pSwapChain)
+		{
+			//The only copy of the frame: straight into the swap chain buffer
+			m_pDeviceContext->UpdateSubresource(m_pSwapChainBuffer, 0, nullptr, pBuffer, UINT(rowSize), UINT(rowSize * m_Height));
+			m_pSwapChain->Present(0, 0);
+		}
+		else
+		{
+			//Main thread only, see PresentToWindow
+			//Converts when the window surface has another layout, a plain copy otherwise
+			SDL_Surface* pWindowSurface{ SDL_GetWindowSurface(m_pWindow) };
+			SDL_LockSurface(pWindowSurface);
+			SDL_ConvertPixels(m_Width, m_Height, SDL_PIXELFORMAT_ARGB8888, pBuffer, int(rowSize),
+				pWindowSurface->format->format, pWindowSurface->pixels, pWindowSurface->pitch);
+			SDL_UnlockSurface(pWindowSurface);
+			SDL_UpdateWindowSurface(m_pWindow);
+		}
+	}
+}
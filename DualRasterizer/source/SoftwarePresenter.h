@@ -0,0 +1,83 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct SDL_Window;
+
+namespace dae
+{
+	// SOFTWARE RASTERIZER
+	// Owns the presentable color buffers the software rasterizer renders into, swapped by pointer
+	// Completed frames go through a bounded queue to a present thread, so rendering frame N + 1 overlaps presenting frame N
+	// When the queue is full the oldest queued frame is dropped, the newest frame is never waited on
+	// Presenting uploads the buffer once into the D3D swap chain buffer (B8G8R8A8, same layout as FrameBuffer::PackColor)
+	// Without a D3D device it copies into the SDL window surface instead, on the main thread because SDL wants the window surface used there
+	class SoftwarePresenter final
+	{
+	public:
+		SoftwarePresenter(SDL_Window* pWindow, int width, int height, int queueDepth,
+			ID3D11DeviceContext* pDeviceContext, IDXGISwapChain* pSwapChain, ID3D11Resource* pSwapChainBuffer);
+		~SoftwarePresenter();
+
+		SoftwarePresenter(const SoftwarePresenter&) = delete;
+		SoftwarePresenter(SoftwarePresenter&&) noexcept = delete;
+		SoftwarePresenter& operator=(const SoftwarePresenter&) = delete;
+		SoftwarePresenter& operator=(SoftwarePresenter&&) noexcept = delete;
+
+		struct Statistics
+		{
+			uint64_t presentCounts;		// performance counts spent presenting
+			uint32_t nrPresentedFrames;
+			uint32_t nrDroppedFrames;	// dropped under backpressure
+		};
+
+		// width * height pixels without row padding, 0xAARRGGBB
+		uint32_t* GetBackBuffer() const { return m_pBuffers[m_BackBufferIndex]; }
+
+		// Queues the back buffer for the present thread and makes a free buffer the back buffer
+		void Present();
+		// Main thread, only without a D3D device: copies the newest queued frame into the window surface, the older ones are dropped
+		void PresentToWindow();
+		// Blocks until every queued frame is presented, needed before something else uses the device context
+		// Main thread, without a D3D device it presents the queue itself
+		void Flush();
+		// Statistics since the previous call
+		Statistics TakeStatistics();
+	private:
+		SDL_Window* m_pWindow;
+		int m_Width;
+		int m_Height;
+		size_t m_QueueDepth;
+
+		// Not owned, only used by the present thread, which only runs when there is a swap chain
+		ID3D11DeviceContext* m_pDeviceContext;
+		IDXGISwapChain* m_pSwapChain;
+		ID3D11Resource* m_pSwapChainBuffer;
+
+		// queue depth + the one being rendered + the one being presented
+		std::vector<uint32_t*> m_pBuffers{};
+		int m_BackBufferIndex{ 0 };
+
+		// Everything below is guarded by m_Mutex
+		std::mutex m_Mutex{};
+		std::condition_variable m_QueueChanged{};
+		// Ring of m_QueueDepth buffer indices, fixed size so presenting never allocates
+		std::vector<int> m_QueuedIndices{};
+		size_t m_QueueFront{ 0 };
+		size_t m_QueueSize{ 0 };
+		std::vector<int> m_FreeIndices{};
+		bool m_IsPresenting{ false };
+		bool m_IsStopping{ false };
+		Statistics m_Statistics{};
+
+		std::thread m_PresentThread{};
+
+		void PresentThreadLoop();
+		// Uploads a buffer that was taken from the queue & gives it back, lock is released during the upload
+		void PresentBuffer(int index, std::unique_lock<std::mutex>& lock);
+		void Upload(const uint32_t* pBuffer) const;
+	};
+}
@@ -0,0 +1,52 @@
+#include "pch.h"
+#include "SpecularLUT.h"
+#include <cassert>
+
+namespace dae
+{
+	SpecularLUT::SpecularLUT(float shininess)
+		: m_Shininess{ shininess }
+	{
+		// First gloss level whose exponent (level / 255 * shininess) is at least 1
+		m_FirstTabulatedLevel = std::min(int(ceilf(255.f / shininess)), m_NrGlossLevels);
+
+		const int nrRows{ m_NrGlossLevels - m_FirstTabulatedLevel };
+		m_Table.resize(size_t(nrRows) * (m_NrCosSamples + 1));
+
+		for (int row{ 0 }; row < nrRows; ++row)
+		{
+			// Same float math as Texture::Sample + PixelShading, so the row matches the exponent exactly
+			const float exponent{ (m_FirstTabulatedLevel + row) / 255.f * m_Shininess };
+			float* pRow{ &m_Table[row * (m_NrCosSamples + 1)] };
+
+			for (int i{ 0 }; i <= m_NrCosSamples; ++i)
+				pRow[i] = powf(float(i) / m_NrCosSamples, exponent);
+		}
+
+#if defined(_DEBUG)
+		ValidateAgainstPowf();
+#endif
+	}
+
+#if defined(_DEBUG)
+	void SpecularLUT::ValidateAgainstPowf()
+	{
+		// Sample each row 16 times between two table entries and keep the worst absolute error
+		constexpr int nrTestSamples{ m_NrCosSamples * 16 };
+
+		m_MaxError = 0.f;
+		for (int level{ m_FirstTabulatedLevel }; level < m_NrGlossLevels; ++level)
+		{
+			const float gloss{ level / 255.f };
+			for (int i{ 0 }; i <= nrTestSamples; ++i)
+			{
+				const float cosAlpha{ float(i) / nrTestSamples };
+				const float error{ fabsf(Evaluate(cosAlpha, gloss) - powf(cosAlpha, gloss * m_Shininess)) };
+				m_MaxError = std::max(m_MaxError, error);
+			}
+		}
+
+		assert(m_MaxError <= ErrorBound && "ERROR: specular lookup table exceeds its error bound!");
+	}
+#endif
+}
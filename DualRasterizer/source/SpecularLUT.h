@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+namespace dae
+{
+	// Precomputed powf(cosAlpha, gloss * shininess) for the software rasterizer
+	// Gloss is sampled from an 8-bit texture, so there are only 256 possible exponents
+	// Every row holds one exponent, linearly interpolated over a quantized cosAlpha
+	class SpecularLUT final
+	{
+	public:
+		SpecularLUT(float shininess);
+		~SpecularLUT() = default;
+
+		SpecularLUT(const SpecularLUT&) = delete;
+		SpecularLUT(SpecularLUT&&) noexcept = delete;
+		SpecularLUT& operator=(const SpecularLUT&) = delete;
+		SpecularLUT& operator=(SpecularLUT&&) noexcept = delete;
+
+		// cosAlpha in [0, 1], gloss in [0, 1] as returned by Texture::Sample
+		float Evaluate(float cosAlpha, float gloss) const
+		{
+			const int glossLevel{ int(gloss * 255.f + .5f) };
+
+			// Exponents below 1 have an unbounded slope at 0, a linear table can't bound the error there
+			if (glossLevel < m_FirstTabulatedLevel)
+				return powf(cosAlpha, gloss * m_Shininess);
+
+			const float x{ std::min(cosAlpha, 1.f) * m_NrCosSamples };
+			const int idx{ std::min(int(x), m_NrCosSamples - 1) };
+			const float* pRow{ &m_Table[(glossLevel - m_FirstTabulatedLevel) * (m_NrCosSamples + 1)] };
+
+			return pRow[idx] + (pRow[idx + 1] - pRow[idx]) * (x - idx);
+		}
+
+		float GetShininess() const { return m_Shininess; }
+
+		// Half a step of an 8-bit color channel, the error is invisible in the backbuffer
+		static constexpr float ErrorBound{ 1.f / 510.f };
+	private:
+		static constexpr int m_NrGlossLevels{ 256 };
+		static constexpr int m_NrCosSamples{ 256 };
+
+		float m_Shininess;
+		int m_FirstTabulatedLevel;
+
+		// [glossLevel][cosSample], one extra sample per row so idx + 1 never leaves the row
+		std::vector<float> m_Table{};
+
+#if defined(_DEBUG)
+		// About a million powf calls, only debug builds check the table at construction
+		float m_MaxError{};
+		void ValidateAgainstPowf();
+#endif
+	};
+}
@@ -1,10 +1,15 @@
 #pragma once
+#include <cassert>
+#include <cmath>
+#include <type_traits>
+#include "SIMD.h"
+#include "Vector2.h"
+#include "Vector3.h"
 
 namespace dae
 {
-	struct Vector2;
-	struct Vector3;
-	struct Vector4
+	//16-byte aligned so it can be loaded in one SIMD register
+	struct alignas(16) Vector4
 	{
 		float x;
 		float y;
@@ -12,25 +17,127 @@ namespace dae
 		float w;
 
 		Vector4() = default;
-		Vector4(float _x, float _y, float _z, float _w);
-		Vector4(const Vector3& v, float _w);
+		constexpr Vector4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+		constexpr Vector4(const Vector3& v, float _w) : x(v.x), y(v.y), z(v.z), w(_w) {}
 
-		float Magnitude() const;
-		float SqrMagnitude() const;
-		float Normalize();
-		Vector4 Normalized() const;
+		float Magnitude() const
+		{
+			return sqrtf(x * x + y * y + z * z + w * w);
+		}
 
-		Vector2 GetXY() const;
-		Vector3 GetXYZ() const;
+		constexpr float SqrMagnitude() const
+		{
+			return x * x + y * y + z * z + w * w;
+		}
 
-		static float Dot(const Vector4& v1, const Vector4& v2);
+		float Normalize()
+		{
+			const float m = Magnitude();
+			x /= m;
+			y /= m;
+			z /= m;
+			w /= m;
 
+			return m;
+		}
+
+		Vector4 Normalized() const
+		{
+			const float m = Magnitude();
+			return { x / m, y / m, z / m, w / m };
+		}
+
+		constexpr Vector2 GetXY() const
+		{
+			return { x, y };
+		}
+
+		constexpr Vector3 GetXYZ() const
+		{
+			return { x,y,z };
+		}
+
+		static constexpr float Dot(const Vector4& v1, const Vector4& v2)
+		{
+			return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z + v1.w * v2.w;
+		}
+
+		simd::Float4 Load() const
+		{
+			return simd::Load(&x);
+		}
+
+		static Vector4 Store(simd::Float4 v)
+		{
+			Vector4 result;
+			simd::Store(&result.x, v);
+			return result;
+		}
+
+#pragma region Operator Overloads
 		// operator overloading
-		Vector4 operator*(float scale) const;
-		Vector4 operator+(const Vector4& v) const;
-		Vector4 operator-(const Vector4& v) const;
-		Vector4& operator+=(const Vector4& v);
-		float& operator[](int index);
-		float operator[](int index) const;
+		constexpr Vector4 operator*(float scale) const
+		{
+			if (std::is_constant_evaluated())
+				return { x * scale, y * scale, z * scale, w * scale };
+
+			return Store(simd::Mul(Load(), simd::Splat(scale)));
+		}
+
+		constexpr Vector4 operator+(const Vector4& v) const
+		{
+			if (std::is_constant_evaluated())
+				return { x + v.x, y + v.y, z + v.z, w + v.w };
+
+			return Store(simd::Add(Load(), v.Load()));
+		}
+
+		constexpr Vector4 operator-(const Vector4& v) const
+		{
+			if (std::is_constant_evaluated())
+				return { x - v.x, y - v.y, z - v.z, w - v.w };
+
+			return Store(simd::Sub(Load(), v.Load()));
+		}
+
+		constexpr Vector4& operator+=(const Vector4& v)
+		{
+			*this = *this + v;
+			return *this;
+		}
+
+		constexpr float& operator[](int index)
+		{
+			assert(index <= 3 && index >= 0);
+
+			if (index == 0)return x;
+			if (index == 1)return y;
+			if (index == 2)return z;
+			return w;
+		}
+
+		constexpr float operator[](int index) const
+		{
+			assert(index <= 3 && index >= 0);
+
+			if (index == 0)return x;
+			if (index == 1)return y;
+			if (index == 2)return z;
+			return w;
+		}
+#pragma endregion
 	};
+
+	//Vector3 members that need a complete Vector4
+	constexpr Vector3::Vector3(const Vector4& v) : x(v.x), y(v.y), z(v.z) {}
+
+	constexpr Vector4 Vector3::ToPoint4() const
+	{
+		return { x, y, z, 1 };
+	}
+
+	constexpr Vector4 Vector3::ToVector4() const
+	{
+		return { x, y, z, 0 };
+	}
 }
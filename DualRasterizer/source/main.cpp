@@ -6,6 +6,8 @@
 
 #undef main
 #include "Renderer.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
 
 // TEXT COLORS
 #define RESET   "\033[0m" 
@@ -23,9 +25,41 @@ void ShutDown(SDL_Window* pWindow)
 
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	//Optional: --isa=SSE2|AVX2|AVX512 forces the software kernel level, e.g. for benchmarks
+	//Optional: --present-queue=<depth> number of finished software frames that can wait for the present thread
+	//Optional: --workers=<count> number of job system workers, --pin-threads pins every worker to its own hardware thread
+	//Optional: --autotune runs the auto-tune sweep at startup, F9 runs it later
+	//Optional: --deterministic starts with the deterministic software schedule, Shift + F9 toggles it
+	//Optional: --check-determinism renders one frame with the deterministic schedule and 0..N active workers in a hidden window,
+	//prints the hash per thread count and exits - 0 when every hash is the same, 1 otherwise
+	int presentQueueDepth{ 2 };
+	int nrWorkers{ 0 };
+	bool isPinningThreads{ false };
+	bool isAutoTuning{ false };
+	bool isDeterministic{ false };
+	bool isCheckingDeterminism{ false };
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string argument{ args[i] };
+		const std::string isaOption{ "--isa=" };
+		const std::string presentQueueOption{ "--present-queue=" };
+		const std::string workersOption{ "--workers=" };
+		if (argument.rfind(isaOption, 0) == 0 && !CpuFeatures::SetOverride(argument.c_str() + isaOption.size()))
+			std::cout << "Unknown ISA level " << argument.substr(isaOption.size()) << ", expected SSE2, AVX2 or AVX512\n";
+		else if (argument.rfind(presentQueueOption, 0) == 0)
+			presentQueueDepth = std::max(1, atoi(argument.c_str() + presentQueueOption.size()));
+		else if (argument.rfind(workersOption, 0) == 0)
+			nrWorkers = std::max(1, atoi(argument.c_str() + workersOption.size()));
+		else if (argument == "--pin-threads")
+			isPinningThreads = true;
+		else if (argument == "--autotune")
+			isAutoTuning = true;
+		else if (argument == "--deterministic")
+			isDeterministic = true;
+		else if (argument == "--check-determinism")
+			isCheckingDeterminism = true;
+	}
+	JobSystem::Configure(nrWorkers, isPinningThreads);
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -37,17 +71,35 @@ int main(int argc, char* args[])
 		"DirectX - ***Vandorpe Jentl, 2DAE08***",
 		SDL_WINDOWPOS_UNDEFINED,
 		SDL_WINDOWPOS_UNDEFINED,
-		width, height, 0);
+		width, height, isCheckingDeterminism ? SDL_WINDOW_HIDDEN : 0);
 
 	if (!pWindow)
 		return 1;
 
 	//Initialize "framework"
 	const auto pTimer = new Timer();
-	const auto pRenderer = new Renderer(pWindow);
+	const auto pRenderer = new Renderer(pWindow, presentQueueDepth);
+	pRenderer->SetDeterministic(isDeterministic);
+
+	//Headless check, no render loop
+	if (isCheckingDeterminism)
+	{
+		const bool isPassed{ pRenderer->CheckDeterminism() };
+
+		delete pRenderer;
+		delete pTimer;
+
+		ShutDown(pWindow);
+		return isPassed ? 0 : 1;
+	}
 
 	//Start loop
 	pTimer->Start();
+	if (isAutoTuning)
+	{
+		pRenderer->Update(pTimer);
+		pRenderer->AutoTune();
+	}
 	float printTimer = 0.f;
 	bool isLooping = true;
 	while (isLooping)
@@ -88,10 +140,28 @@ int main(int argc, char* args[])
 					pRenderer->CycleShadingMode();
 				else if (e.key.keysym.scancode == SDL_SCANCODE_F6)
 					pRenderer->StateNormalMap();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F7 && (e.key.keysym.mod & KMOD_SHIFT))
+					pRenderer->ToggleDepthCompression();
 				else if (e.key.keysym.scancode == SDL_SCANCODE_F7)
 					pRenderer->ToggleDepthBuffer();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F8 && (e.key.keysym.mod & KMOD_CTRL))
+					pRenderer->ToggleMeshletCulling();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F8 && (e.key.keysym.mod & KMOD_SHIFT))
+					pRenderer->ToggleTriangleSort();
 				else if (e.key.keysym.scancode == SDL_SCANCODE_F8)
 					pRenderer->ToggleBoundingBox();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F9 && (e.key.keysym.mod & KMOD_CTRL))
+					pRenderer->CheckDeterminism();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F9 && (e.key.keysym.mod & KMOD_SHIFT))
+					pRenderer->ToggleDeterministic();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F9)
+					pRenderer->AutoTune();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F12 && (e.key.keysym.mod & KMOD_CTRL))
+					pRenderer->ValidateEngines();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F12 && (e.key.keysym.mod & KMOD_SHIFT))
+					pRenderer->CycleShadingEngine();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F12)
+					pRenderer->CycleRasterEngine();
 				break;
 			default: ;
 			}
@@ -112,6 +182,7 @@ int main(int argc, char* args[])
 			{
 				printTimer = 0.f;
 				std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+				pRenderer->PrintStageTimings();
 			}
 		}
 	}